@@ -55,6 +55,15 @@ private:
   /*! \brief Main Convert model logic */
   void ConvertModel();
 
+  /*! \brief Build the binary dataset of a raw window corpus */
+  void BuildDataset();
+
+  /*! \brief Build only the feature index of a raw window corpus */
+  void BuildIndex();
+
+  /*! \brief Feature index of the raw window corpus */
+  std::string FeatureIndexFilename() const;
+
   /*! \brief All configs */
   OverallConfig config_;
   /*! \brief Training data */
@@ -69,6 +78,8 @@ private:
   std::unique_ptr<Boosting> boosting_;
   /*! \brief Training objective function */
   std::unique_ptr<ObjectiveFunction> objective_fun_;
+  /*! \brief Checkpoint state of input_model, restored instead of re-scoring the data. Empty means not used */
+  std::string checkpoint_state_;
 };
 
 
@@ -78,6 +89,10 @@ inline void Application::Run() {
     Predict();
   } else if (config_.task_type == TaskType::kConvertModel) {
     ConvertModel();
+  } else if (config_.task_type == TaskType::kBuildDataset) {
+    BuildDataset();
+  } else if (config_.task_type == TaskType::kBuildIndex) {
+    BuildIndex();
   } else {
     InitTrain();
     Train();
@@ -23,13 +23,26 @@ enum MissingType {
   NaN
 };
 
+#ifdef USE_COMPACT_HISTOGRAM
+#ifdef USE_GPU
+#error "USE_COMPACT_HISTOGRAM cannot be used with USE_GPU"
+#endif
+/*!
+* \brief Type of the hessian sums in histograms. With float a bin entry has 16 bytes instead of 24,
+*        gradients stay double because their sums cancel out and need the precision
+*/
+typedef float hist_hess_t;
+#else
+typedef double hist_hess_t;
+#endif
+
 /*! \brief Store data for one histogram bin */
 struct HistogramBinEntry {
 public:
   /*! \brief Sum of gradients on this bin */
   double sum_gradients = 0.0f;
   /*! \brief Sum of hessians on this bin */
-  double sum_hessians = 0.0f;
+  hist_hess_t sum_hessians = 0.0f;
   /*! \brief Number of data on this bin */
   data_size_t cnt = 0;
   /*!
@@ -55,6 +68,35 @@ public:
   }
 };
 
+/*!
+* \brief Gradient and hessian of one data quantized to integers and packed in one word,
+*        the gradient in the high 32 bits and the non-negative hessian in the low 32 bits.
+*        Adding packed words adds both, as long as the sum of hessians fits in 32 bits
+*/
+typedef int64_t packed_grad_t;
+
+/*! \brief Store data for one histogram bin of quantized gradients */
+struct QuantizedHistogramBinEntry {
+public:
+  /*! \brief Packed sums of the quantized gradients and hessians on this bin */
+  packed_grad_t sum_gradients_hessians;
+  /*! \brief Number of data on this bin */
+  data_size_t cnt;
+
+  /*! \brief Pack a quantized gradient and hessian */
+  static inline packed_grad_t Pack(int32_t gradient, uint32_t hessian) {
+    return static_cast<packed_grad_t>((static_cast<uint64_t>(static_cast<int64_t>(gradient)) << 32) + hessian);
+  }
+  /*! \brief Sum of the quantized hessians on this bin */
+  inline int64_t sum_hessians() const {
+    return static_cast<uint32_t>(sum_gradients_hessians);
+  }
+  /*! \brief Sum of the quantized gradients on this bin */
+  inline int64_t sum_gradients() const {
+    return (sum_gradients_hessians - sum_hessians()) >> 32;
+  }
+};
+
 /*! \brief This class used to convert feature values into bin,
 *          and store some meta information for bin*/
 class BinMapper {
@@ -240,6 +282,18 @@ public:
   virtual void ConstructHistogram(int leaf, const score_t* gradients,
     const score_t* hessians, HistogramBinEntry* out) const = 0;
 
+  /*!
+  * \brief Construct histogram of a part of the leaf's data by using this bin
+  * \param leaf Using which leaf's data to construct
+  * \param start Start of the part, in the non-zero data of the leaf
+  * \param end End of the part, at most NonZeroCount(leaf)
+  * \param gradients Gradients, Note:non-oredered by leaf
+  * \param hessians Hessians, Note:non-oredered by leaf
+  * \param out Output Result
+  */
+  virtual void ConstructHistogram(int leaf, data_size_t start, data_size_t end, const score_t* gradients,
+    const score_t* hessians, HistogramBinEntry* out) const = 0;
+
   /*!
   * \brief Construct histogram by using this bin
   *        Note: Unlike Bin, OrderedBin doesn't use ordered gradients and ordered hessians.
@@ -250,6 +304,15 @@ public:
   */
   virtual void ConstructHistogram(int leaf, const score_t* gradients, HistogramBinEntry* out) const = 0;
 
+  /*!
+  * \brief Construct histogram of quantized gradients by using this bin
+  * \param leaf Using which leaf's data to construct
+  * \param packed_gradients Packed quantized gradients and hessians, Note:non-oredered by leaf
+  * \param out Output Result
+  */
+  virtual void ConstructHistogram(int leaf, const packed_grad_t* packed_gradients,
+                                  QuantizedHistogramBinEntry* out) const = 0;
+
   /*!
   * \brief Split current bin, and perform re-order by leaf
   * \param leaf Using which leaf's to split
@@ -319,6 +382,13 @@ public:
   virtual void LoadFromMemory(const void* memory,
     const std::vector<data_size_t>& local_used_indices) = 0;
 
+  /*!
+  * \brief Use the data written by SaveBinaryToFile in place instead of copying it
+  * \param memory Data in memory that outlives this bin, e.g. a memory mapped file
+  * \return False if memory is not aligned for the bin values, LoadFromMemory should be used then
+  */
+  virtual bool MapFromMemory(const void* memory) = 0;
+
   /*!
   * \brief Get sizes in byte of this object
   */
@@ -369,6 +439,21 @@ public:
   virtual void ConstructHistogram(data_size_t num_data,
                                   const score_t* ordered_gradients, HistogramBinEntry* out) const = 0;
 
+  /*!
+  * \brief Construct histogram of quantized gradients of this feature, with one add per data
+  * \param data_indices Used data indices in current leaf
+  * \param num_data Number of used data
+  * \param ordered_packed_gradients Packed quantized gradients and hessians, the data_indices[i]-th data's is ordered_packed_gradients[i]
+  * \param out Output Result
+  */
+  virtual void ConstructHistogram(const data_size_t* data_indices, data_size_t num_data,
+                                  const packed_grad_t* ordered_packed_gradients,
+                                  QuantizedHistogramBinEntry* out) const = 0;
+
+  virtual void ConstructHistogram(data_size_t num_data,
+                                  const packed_grad_t* ordered_packed_gradients,
+                                  QuantizedHistogramBinEntry* out) const = 0;
+
   /*!
   * \brief Split data according to threshold, if bin <= threshold, will put into left(lte_indices), else put into right(gt_indices)
   * \param min_bin min_bin of current used feature
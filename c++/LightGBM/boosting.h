@@ -56,7 +56,7 @@ public:
   virtual void AddValidDataset(const Dataset* valid_data,
                                const std::vector<const Metric*>& valid_metrics) = 0;
 
-  virtual void Train(int snapshot_freq, const std::string& model_output_path) = 0;
+  virtual void Train(int snapshot_freq, bool is_snapshot_log, const std::string& model_output_path) = 0;
 
   /*!
   * \brief Training logic
@@ -164,6 +164,31 @@ public:
   */
   virtual bool SaveModelToIfElse(int num_iteration, const char* filename) const = 0;
 
+  /*!
+  * \brief Translate model to static node tables with a sparse-input traversal kernel
+  * \param num_iteration Number of iterations that want to translate, -1 means translate all
+  * \return C++ codes of model
+  */
+  virtual std::string ModelToNodeTable(int num_iteration) const = 0;
+
+  /*!
+  * \brief Translate model to static node tables and save it
+  * \param num_iteration Number of iterations that want to translate, -1 means translate all
+  * \param filename Filename that want to save to
+  * \param benchmark_filename Filename of the generated benchmark against the interpreted predictor,
+  *        empty means no benchmark
+  * \return true if succeeded
+  */
+  virtual bool SaveModelToNodeTable(int num_iteration, const char* filename, const char* benchmark_filename) const = 0;
+
+  /*!
+  * \brief Save model to the compact binary inference format, without training-only information
+  * \param num_iteration Number of iterations that want to save, -1 means save all
+  * \param filename Filename that want to save to
+  * \return true if succeeded
+  */
+  virtual bool SaveModelToInference(int num_iteration, const char* filename) const = 0;
+
   /*!
   * \brief Save model to file
   * \param num_used_model Number of model that want to save, -1 means save all
@@ -187,6 +212,21 @@ public:
   */
   virtual bool LoadModelFromString(const std::string& model_str) = 0;
 
+  /*!
+  * \brief Check that a checkpoint state matches the loaded models, without reading the scores
+  * \param filename Filename of the checkpoint state
+  * \return true if the state can be restored after Init and AddValidDataset
+  */
+  virtual bool CheckCheckpointState(const char* filename) const = 0;
+
+  /*!
+  * \brief Restore scores, bagging and iteration counters from a checkpoint state,
+  *        instead of re-scoring the data with the loaded models
+  * \param filename Filename of the checkpoint state
+  * \return true if succeeded
+  */
+  virtual bool LoadCheckpointState(const char* filename) = 0;
+
   /*!
   * \brief Calculate feature importances
   * \param num_iteration Number of model that want to use for feature importance, -1 means use all
@@ -240,6 +280,12 @@ public:
   */
   virtual void InitPredict(int num_iteration) = 0;
 
+  /*!
+  * \brief True if the trees used for the prediction keep the split gains and data counts of training,
+  *        feature contributions need them. Call after InitPredict
+  */
+  virtual bool HasTrainingInfo() const = 0;
+
   /*!
   * \brief Name of submodel
   */
@@ -87,7 +87,7 @@ public:
 
 /*! \brief Types of tasks */
 enum TaskType {
-  kTrain, kPredict, kConvertModel
+  kTrain, kPredict, kConvertModel, kBuildDataset, kBuildIndex
 };
 
 /*! \brief Config for input and output files */
@@ -101,9 +101,16 @@ public:
   std::vector<std::string> valid_data_filenames;
   std::vector<std::string> valid_data_initscores;
   int snapshot_freq = -1;
+  /*! \brief Append only the new trees of each snapshot to output_model.snapshot_log,
+   *         instead of writing a full model file per snapshot. Not supported by dart,
+   *         which rescales earlier trees
+   */
+  bool is_snapshot_log = false;
   std::string output_model = "LightGBM_model.txt";
   std::string output_result = "LightGBM_predict_result.txt";
   std::string convert_model = "gbdt_prediction.cpp";
+  /*! \brief Output benchmark of convert_model_language=cpp_table against the interpreted predictor, empty means not used */
+  std::string convert_model_benchmark = "";
   std::string input_model = "";
   int verbosity = 1;
   int num_iteration_predict = -1;
@@ -115,7 +122,27 @@ public:
    */
   double sparse_threshold = 0.8;
   bool use_two_round_loading = false;
+  /*! \brief Read the text data once, spool the parsed rows to a temporary file
+   *         while sampling them for the bins, then bin the rows from the spool
+   */
+  bool use_streaming_loading = false;
+  /*! \brief Directory of the spool file of use_streaming_loading, TMPDIR or /tmp if empty */
+  std::string spool_dir = "";
   bool is_save_binary_file = false;
+  /*! \brief Compress the saved binary file in blocks, smaller on disk and read into memory in parallel instead of mapped */
+  bool is_save_binary_compressed = false;
+  /*! \brief Feature index of task=build_dataset, built from the raw corpus and saved here if it doesn't exist.
+   *         Empty means data_filename.index
+   */
+  std::string feature_index = "";
+  /*! \brief Keys of the raw corpus that appear less often than this are left out of a new feature index */
+  int min_feature_count = 1;
+  /*! \brief Ids of the raw corpus features are hash(pos, char) mod 2^feature_hash_bits instead of
+   *         the feature index, 0 means the feature index is used
+   */
+  int feature_hash_bits = 0;
+  /*! \brief Hashed features are +-1 by the hash, so colliding features cancel out on average */
+  bool is_feature_hash_signed = false;
   bool enable_load_from_binary_file = true;
   int bin_construct_sample_cnt = 200000;
   bool is_predict_leaf_index = false;
@@ -125,6 +152,11 @@ public:
   int min_data_in_bin = 3;
   double max_conflict_rate = 0.0f;
   bool enable_bundle = true;
+  /*! \brief File of mutually exclusive feature sets, one line of feature indices per set.
+   *         Each set is bundled to one group directly, without searching groups. A set with more conflicts
+   *         on the sampled data than max_conflict_rate allows is bundled as usual, with a warning
+   */
+  std::string feature_group_file = "";
   bool has_header = false;
   /*! \brief Index or column name of label, default is the first column
    * And add an prefix "name:" while using column name */
@@ -207,8 +239,12 @@ public:
   int num_leaves = kDefaultNumLeaves;
   int feature_fraction_seed = 2;
   double feature_fraction = 1.0f;
-  // max cache size(unit:MB) for historical histogram. < 0 means no limit
+  // max cache size(unit:MB) for historical histogram. 0 means no limit, < 0 means half of the available memory
+  // when the histograms of all leaves don't fit in it, otherwise no limit
   double histogram_pool_size = -1.0f;
+  // fraction of histogram_pool_size for the non-empty bins of evicted histograms, which are restored instead of rebuilt.
+  // 0 means disabled and the whole pool holds dense histograms
+  double histogram_pool_sparse_fraction = 0.0f;
   // max depth of tree model.
   // Still grow tree by leaf-wise, but limit the max depth to avoid over-fitting
   // And the max leaves will be min(num_leaves, pow(2, max_depth))
@@ -230,6 +266,25 @@ public:
   double cat_l2 = 10;
   double cat_smooth = 10;
   int max_cat_to_onehot = 4;
+  /*! \brief Bits to quantize gradients and hessians for histogram construction, 0 means not quantized, not for gpu */
+  int gradient_quant_bits = 0;
+  /*! \brief Always construct histograms by rows, only for the serial cpu tree learner */
+  bool force_row_wise = false;
+  /*! \brief Always construct histograms by feature groups */
+  bool force_col_wise = false;
+  /*!
+  * \brief Number of leaves with the largest gains to split per round, 1 means grow leaf-wise.
+  *        This changes the trees: a leaf of the batch is split even if a child split in the same
+  *        round would have a larger gain, which can cost accuracy
+  */
+  int leaf_batch_size = 1;
+  /*!
+  * \brief Leaves of a batch need at least this fraction of the largest gain of the round,
+  *        the others wait for a later round. 0 always splits leaf_batch_size leaves, about
+  *        num_leaves / leaf_batch_size rounds per tree. Larger ratios keep more of the leaf-wise
+  *        accuracy but fall back to nearly one leaf per round when the gains are skewed
+  */
+  double leaf_batch_min_gain_ratio = 0.0f;
   LIGHTGBM_EXPORT void Set(const std::unordered_map<std::string, std::string>& params) override;
 };
 
@@ -408,9 +463,14 @@ struct ParameterAlias {
       { "local_port", "local_listen_port" },
       { "two_round_loading", "use_two_round_loading"},
       { "two_round", "use_two_round_loading" },
+      { "streaming_loading", "use_streaming_loading" },
+      { "streaming", "use_streaming_loading" },
+      { "feature_hash_signed", "is_feature_hash_signed" },
       { "mlist", "machine_list_file" },
       { "is_save_binary", "is_save_binary_file" },
       { "save_binary", "is_save_binary_file" },
+      { "save_binary_compressed", "is_save_binary_compressed" },
+      { "snapshot_log", "is_snapshot_log" },
       { "early_stopping_rounds", "early_stopping_round"},
       { "early_stopping", "early_stopping_round"},
       { "verbosity", "verbose" },
@@ -450,8 +510,8 @@ struct ParameterAlias {
       "ndcg_eval_at", "min_data_in_leaf", "min_sum_hessian_in_leaf",
       "num_leaves", "feature_fraction", "num_iterations",
       "bagging_fraction", "bagging_freq", "learning_rate", "tree_learner",
-      "num_machines", "local_listen_port", "use_two_round_loading",
-      "machine_list_file", "is_save_binary_file", "early_stopping_round",
+      "num_machines", "local_listen_port", "use_two_round_loading", "use_streaming_loading", "spool_dir",
+      "machine_list_file", "is_save_binary_file", "is_save_binary_compressed", "feature_index", "feature_group_file", "min_feature_count", "feature_hash_bits", "is_feature_hash_signed", "early_stopping_round",
       "verbose", "has_header", "label_column", "weight_column", "group_column",
       "ignore_column", "categorical_column", "is_predict_raw_score",
       "is_predict_leaf_index", "min_gain_to_split", "top_k",
@@ -466,13 +526,15 @@ struct ParameterAlias {
       "boost_from_average", "max_position", "label_gain",
       "metric", "metric_freq", "time_out",
       "gpu_platform_id", "gpu_device_id", "gpu_use_dp",
-      "convert_model", "convert_model_language",
+      "convert_model", "convert_model_language", "convert_model_benchmark",
       "feature_fraction_seed", "enable_bundle", "data_filename", "valid_data_filenames",
-      "snapshot_freq", "verbosity", "sparse_threshold", "enable_load_from_binary_file",
+      "snapshot_freq", "is_snapshot_log", "verbosity", "sparse_threshold", "enable_load_from_binary_file",
       "max_conflict_rate", "poisson_max_delta_step", "gaussian_eta",
       "histogram_pool_size", "output_freq", "is_provide_training_metric", "machine_list_filename", "machines",
       "zero_as_missing", "init_score_file", "valid_init_score_file", "is_predict_contrib",
-      "max_cat_threshold",  "cat_smooth", "min_data_per_group", "cat_l2", "max_cat_to_onehot"
+      "max_cat_threshold",  "cat_smooth", "min_data_per_group", "cat_l2", "max_cat_to_onehot",
+      "gradient_quant_bits", "force_row_wise", "force_col_wise", "histogram_pool_sparse_fraction",
+      "leaf_batch_size", "leaf_batch_min_gain_ratio"
     });
     std::unordered_map<std::string, std::string> tmp_map;
     for (const auto& pair : *params) {
@@ -3,6 +3,7 @@
 
 #include <LightGBM/utils/random.h>
 #include <LightGBM/utils/text_reader.h>
+#include <LightGBM/utils/mapped_file.h>
 #include <LightGBM/utils/openmp_wrapper.h>
 
 #include <LightGBM/meta.h>
@@ -382,13 +383,19 @@ public:
 
   /*!
   * \brief Save current dataset into binary file, will save to "filename.bin"
+  * \param is_compressed True to compress the file in blocks, it is then read into memory instead of mapped
   */
-  LIGHTGBM_EXPORT void SaveBinaryFile(const char* bin_filename);
+  LIGHTGBM_EXPORT void SaveBinaryFile(const char* bin_filename, bool is_compressed = false);
 
   LIGHTGBM_EXPORT void CopyFeatureMapperFrom(const Dataset* dataset);
 
   LIGHTGBM_EXPORT void CreateValid(const Dataset* dataset);
 
+  /*!
+  * \brief Construct the histograms of the used groups for the data of a leaf
+  * \param is_gradients_ordered True if ordered_gradients (and ordered_hessians) already hold the
+  *        gradients of data_indices, e.g. gathered while partitioning the data
+  */
   void ConstructHistograms(const std::vector<int8_t>& is_feature_used,
                            const data_size_t* data_indices, data_size_t num_data,
                            int leaf_idx,
@@ -396,11 +403,80 @@ public:
                            const score_t* gradients, const score_t* hessians,
                            score_t* ordered_gradients, score_t* ordered_hessians,
                            bool is_constant_hessian,
-                           HistogramBinEntry* histogram_data) const;
+                           HistogramBinEntry* histogram_data,
+                           bool is_gradients_ordered = false) const;
+
+  /*! \brief Histograms of one leaf, for constructing the histograms of several leaves at once */
+  struct LeafHistogram {
+    int leaf_idx;
+    const data_size_t* data_indices;
+    data_size_t num_data;
+    /*! \brief Gradients and hessians in the order of data_indices */
+    score_t* ordered_gradients;
+    score_t* ordered_hessians;
+    /*! \brief True if ordered_gradients (and ordered_hessians) are already gathered, else they are gathered here */
+    bool is_gradients_ordered;
+    HistogramBinEntry* histogram_data;
+  };
+
+  /*!
+  * \brief Construct the histograms of the used groups for several leaves, with one parallel loop over
+  *        the (leaf, group) pairs. The leaves must not overlap in their ordered gradients
+  */
+  void ConstructHistograms(const std::vector<int8_t>& is_feature_used,
+                           const std::vector<LeafHistogram>& leaves,
+                           std::vector<std::unique_ptr<OrderedBin>>& ordered_bins,
+                           const score_t* gradients, const score_t* hessians,
+                           bool is_constant_hessian) const;
+
+  /*!
+  * \brief Construct histograms from quantized gradients, and rescale them to histogram_data
+  * \param quantized_histogram_data Buffer of NumTotalBin() entries for the integer histograms
+  * \param gradient_scale Gradient of one quantization step
+  * \param hessian_scale Hessian of one quantization step
+  */
+  void ConstructQuantizedHistograms(const std::vector<int8_t>& is_feature_used,
+                                    const data_size_t* data_indices, data_size_t num_data,
+                                    int leaf_idx,
+                                    std::vector<std::unique_ptr<OrderedBin>>& ordered_bins,
+                                    const packed_grad_t* packed_gradients,
+                                    packed_grad_t* ordered_packed_gradients,
+                                    double gradient_scale, double hessian_scale,
+                                    QuantizedHistogramBinEntry* quantized_histogram_data,
+                                    HistogramBinEntry* histogram_data) const;
 
   void FixHistogram(int feature_idx, double sum_gradient, double sum_hessian, data_size_t num_data,
                     HistogramBinEntry* data) const;
 
+  /*!
+  * \brief Expected number of groups with a non-zero bin in a row, estimated from the sparse rates.
+  *        The features of a group are exclusive, so their non-zero rates add up, like in FeatureGroup
+  */
+  double ExpectedNonZeroGroupsPerRow() const;
+
+  /*!
+  * \brief Store the non-zero bins of all groups by row (CSR), as global bin ids like the histogram indices
+  * \param row_ptr Bins of row i are row_bins[row_ptr[i], row_ptr[i + 1])
+  * \param row_bins Global bin ids
+  */
+  void CreateRowWiseBins(std::vector<uint64_t>* row_ptr, std::vector<uint32_t>* row_bins) const;
+
+  /*!
+  * \brief Construct the histograms of all groups with one pass over the rows of the leaf,
+  *        for data with few non-zero bins per row compared with the number of groups.
+  *        The rows are split to blocks with private histograms, which are summed at the end
+  * \param row_ptr Created by CreateRowWiseBins
+  * \param row_bins Created by CreateRowWiseBins
+  * \param num_threads Number of threads, at most one block per thread
+  * \param hist_buffer Buffer for the private histograms of the blocks
+  */
+  void ConstructRowWiseHistograms(const std::vector<uint64_t>& row_ptr, const std::vector<uint32_t>& row_bins,
+                                  const data_size_t* data_indices, data_size_t num_data,
+                                  const score_t* gradients, const score_t* hessians,
+                                  bool is_constant_hessian, int num_threads,
+                                  std::vector<HistogramBinEntry>* hist_buffer,
+                                  HistogramBinEntry* hist_data) const;
+
   inline data_size_t Split(int feature,
                            const uint32_t* threshold, int num_threshold,  bool default_left,
                            data_size_t* data_indices, data_size_t num_data,
@@ -539,6 +615,8 @@ public:
 
 private:
   const char* data_filename_;
+  /*! \brief Memory mapped binary file the bin data of feature groups can point into */
+  std::unique_ptr<MappedFile> bin_file_;
   /*! \brief Store used features */
   std::vector<std::unique_ptr<FeatureGroup>> feature_groups_;
   /*! \brief Mapper from real feature index to used index*/
@@ -559,6 +637,37 @@ private:
   std::vector<std::string> feature_names_;
   /*! \brief store feature names */
   static const char* binary_file_token;
+  /*! \brief Token of binary files compressed by blocks */
+  static const char* compressed_binary_file_token;
+  /*! \brief Bytes of the uncompressed file in a block of a compressed binary file */
+  static const size_t kCompressedBinaryBlockSize = 4 * 1024 * 1024;
+  /*!
+  * \brief Compress the binary file raw_filename to bin_filename. The rest of the file after its token
+  *        is compressed in independent blocks of kCompressedBinaryBlockSize bytes, by all threads.
+  *        Layout: token, size_t raw size, size_t block size, the blocks, size_t compressed size of each block
+  */
+  static void CompressBinaryFile(const char* raw_filename, const char* bin_filename);
+  /*!
+  * \brief Construct the histogram of group from num_data data. With USE_COMPACT_HISTOGRAM a float hessian sum
+  *        stops growing once it is large, so the data is added in blocks of kHessianBlockSize to a private
+  *        histogram, and the hessian sums of the blocks are summed in double
+  * \param out Histogram of group, zeroed except bin zero
+  * \param construct_fun Add data [start, start + cnt) to a zeroed histogram, called with (start, cnt, out)
+  */
+  template<typename CONSTRUCT_FUN>
+  void ConstructHistogramByHessianBlocks(int group, data_size_t num_data, HistogramBinEntry* out,
+                                         const CONSTRUCT_FUN& construct_fun) const;
+  /*! \brief Number of data whose hessians are summed in float, with USE_COMPACT_HISTOGRAM */
+  static const data_size_t kHessianBlockSize = 16384;
+  /*!
+  * \brief Sort groups by the estimated cost of their histograms, most expensive first, so the
+  *        dynamically scheduled threads don't end with one big group left
+  */
+  void SortGroupsByCost(std::vector<int>* groups) const;
+  /*! \brief Rescale the quantized histogram of group to hist_data */
+  void RescaleQuantizedHistogram(int group, double gradient_scale, double hessian_scale,
+                                 const QuantizedHistogramBinEntry* quantized_hist_data,
+                                 HistogramBinEntry* hist_data) const;
   int num_groups_;
   std::vector<int> real_feature_idx_;
   std::vector<int> feature2group_;
@@ -5,6 +5,9 @@
 
 namespace LightGBM {
 
+class WindowFeatureIndex;
+class WindowFeatureCounter;
+
 class DatasetLoader {
 public:
 
@@ -24,6 +27,25 @@ public:
     int** sample_indices, int num_col, const int* num_per_col,
     size_t total_sample_size, data_size_t num_data);
 
+  /*!
+  * \brief Build a dataset from the raw window corpus of "head o tail" / "head x tail" lines,
+  *        without writing and parsing it as LibSVM text
+  * \param filename Raw corpus
+  * \param index_filename Feature index, loaded if it exists, otherwise built from the corpus and saved there
+  */
+  LIGHTGBM_EXPORT Dataset* LoadFromCorpus(const char* filename, const char* index_filename);
+
+  /*!
+  * \brief Count the window feature keys of the raw corpus with all threads, then give ids to the keys
+  *        that appear at least min_feature_count times, in the order they first appear.
+  *        Saves the index to index_filename, the count of every key to index_filename.stats
+  *        and the ids of each position to index_filename.groups
+  * \param out_index Index built
+  * \return Number of lines of the corpus
+  */
+  LIGHTGBM_EXPORT data_size_t BuildCorpusIndex(const char* filename, const char* index_filename,
+                                               WindowFeatureIndex* out_index);
+
   /*! \brief Disable copy */
   DatasetLoader& operator=(const DatasetLoader&) = delete;
   /*! \brief Disable copy */
@@ -37,20 +59,46 @@ private:
 
   void CheckDataset(const Dataset* dataset);
 
-  std::vector<std::string> LoadTextDataToMemory(const char* filename, const Metadata& metadata, int rank, int num_machines, int* num_global_data, std::vector<data_size_t>* used_data_indices);
+  void LoadTextDataToMemory(MappedTextReader<data_size_t>* text_reader, const Metadata& metadata, int rank, int num_machines, int* num_global_data, std::vector<data_size_t>* used_data_indices);
 
-  std::vector<std::string> SampleTextDataFromMemory(const std::vector<std::string>& data);
+  std::vector<std::string> SampleTextDataFromMemory(const std::vector<TextLine>& data);
 
   std::vector<std::string> SampleTextDataFromFile(const char* filename, const Metadata& metadata, int rank, int num_machines, int* num_global_data, std::vector<data_size_t>* used_data_indices);
 
+  /*!
+  * \brief Parse the text data in one pass and write the rows to a spool file
+  * \param spool_file Open temporary file, the rows are appended to it
+  * \param sample_cnt Number of lines to keep as sample for the bin mappers, reservoir sampled
+  * \return The sampled lines
+  */
+  std::vector<std::string> SpoolTextDataToFile(const char* filename, FILE* spool_file, const Parser* parser,
+                                               const Metadata& metadata, int rank, int num_machines, data_size_t sample_cnt,
+                                               int* num_global_data, std::vector<data_size_t>* used_data_indices);
+
   void ConstructBinMappersFromTextData(int rank, int num_machines, const std::vector<std::string>& sample_data, const Parser* parser, Dataset* dataset);
 
   /*! \brief Extract local features from memory */
-  void ExtractFeaturesFromMemory(std::vector<std::string>& text_data, const Parser* parser, Dataset* dataset);
+  void ExtractFeaturesFromMemory(const std::vector<TextLine>& text_data, const Parser* parser, Dataset* dataset);
 
   /*! \brief Extract local features from file */
   void ExtractFeaturesFromFile(const char* filename, const Parser* parser, const std::vector<data_size_t>& used_data_indices, Dataset* dataset);
 
+  /*! \brief Extract local features from the spool file written by SpoolTextDataToFile */
+  void ExtractFeaturesFromSpool(FILE* spool_file, Dataset* dataset);
+
+  /*!
+  * \brief Count the window feature keys of the raw corpus with all threads
+  * \return Number of lines of the corpus
+  */
+  data_size_t CountCorpusKeys(const char* filename, WindowFeatureCounter* out_counter);
+
+  /*!
+  * \brief Decompress a binary file written by Dataset::SaveBinaryFile with is_compressed,
+  *        the blocks are decompressed by all threads
+  * \return Content of the uncompressed binary file
+  */
+  MappedFile* DecompressBinaryFile(const MappedFile& file, const char* bin_filename);
+
   /*! \brief Check can load from binary file */
   std::string CheckCanLoadFromBin(const char* filename);
 
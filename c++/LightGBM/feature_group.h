@@ -17,6 +17,9 @@ class DatasetLoader;
 /*! \brief Using to store data and providing some operations on one feature group*/
 class FeatureGroup {
 public:
+  /*! \brief Bin data of at least this size starts at a multiple of it in binary files */
+  static const size_t kBinaryPageSize = 4096;
+
   friend Dataset;
   friend DatasetLoader;
   /*!
@@ -78,9 +81,10 @@ public:
   * \param memory Pointer of memory
   * \param num_all_data Number of global data
   * \param local_used_indices Local used indices, empty means using all data
+  * \param is_memory_mapped True if memory outlives this group, then the bin data is used in place when possible
   */
   FeatureGroup(const void* memory, data_size_t num_all_data,
-    const std::vector<data_size_t>& local_used_indices) {
+    const std::vector<data_size_t>& local_used_indices, bool is_memory_mapped = false) {
     const char* memory_ptr = reinterpret_cast<const char*>(memory);
     // get is_sparse
     is_sparse_ = *(reinterpret_cast<const bool*>(memory_ptr));
@@ -112,8 +116,13 @@ public:
     } else {
       bin_data_.reset(Bin::CreateDenseBin(num_data, num_total_bin_));
     }
+    // skip padding before bin data
+    const size_t padding = *(reinterpret_cast<const size_t*>(memory_ptr));
+    memory_ptr += sizeof(padding) + padding;
     // get bin data
-    bin_data_->LoadFromMemory(memory_ptr, local_used_indices);
+    if (!is_memory_mapped || !local_used_indices.empty() || !bin_data_->MapFromMemory(memory_ptr)) {
+      bin_data_->LoadFromMemory(memory_ptr, local_used_indices);
+    }
   }
   /*! \brief Destructor */
   ~FeatureGroup() {
@@ -188,27 +197,30 @@ public:
   }
 
   /*!
-  * \brief Save binary data to file
+  * \brief Save binary data to file, the bin data is padded to start aligned in the file
   * \param file File want to write
+  * \param offset Position in the file this group starts at
   */
-  void SaveBinaryToFile(FILE* file) const {
+  void SaveBinaryToFile(FILE* file, size_t offset) const {
     fwrite(&is_sparse_, sizeof(is_sparse_), 1, file);
     fwrite(&num_feature_, sizeof(num_feature_), 1, file);
     for (int i = 0; i < num_feature_; ++i) {
       bin_mappers_[i]->SaveBinaryToFile(file);
     }
+    const size_t padding = BinDataPadding(offset);
+    fwrite(&padding, sizeof(padding), 1, file);
+    if (padding > 0) {
+      std::vector<char> zeros(padding, 0);
+      fwrite(zeros.data(), sizeof(char), padding, file);
+    }
     bin_data_->SaveBinaryToFile(file);
   }
   /*!
   * \brief Get sizes in byte of this object
+  * \param offset Position in the file this group starts at
   */
-  size_t SizesInByte() const {
-    size_t ret = sizeof(is_sparse_) + sizeof(num_feature_);
-    for (int i = 0; i < num_feature_; ++i) {
-      ret += bin_mappers_[i]->SizesInByte();
-    }
-    ret += bin_data_->SizesInByte();
-    return ret;
+  size_t SizesInByte(size_t offset) const {
+    return HeaderSizesInByte() + sizeof(size_t) + BinDataPadding(offset) + bin_data_->SizesInByte();
   }
   /*! \brief Disable copy */
   FeatureGroup& operator=(const FeatureGroup&) = delete;
@@ -216,6 +228,23 @@ public:
   FeatureGroup(const FeatureGroup&) = delete;
 
 private:
+  size_t HeaderSizesInByte() const {
+    size_t ret = sizeof(is_sparse_) + sizeof(num_feature_);
+    for (int i = 0; i < num_feature_; ++i) {
+      ret += bin_mappers_[i]->SizesInByte();
+    }
+    return ret;
+  }
+  /*!
+  * \brief Bytes of padding before the bin data. Bin data of at least one page starts at a page,
+  *        so mapped groups don't share pages, smaller bin data is only aligned for its values
+  */
+  size_t BinDataPadding(size_t offset) const {
+    const size_t data_offset = offset + HeaderSizesInByte() + sizeof(size_t);
+    const size_t alignment = bin_data_->SizesInByte() >= kBinaryPageSize ? kBinaryPageSize : sizeof(uint64_t);
+    return (alignment - data_offset % alignment) % alignment;
+  }
+
   /*! \brief Number of features */
   int num_feature_;
   /*! \brief Bin mapper for sub features */
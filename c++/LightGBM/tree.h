@@ -31,6 +31,15 @@ public:
   */
   explicit Tree(const std::string& str);
 
+  /*!
+  * \brief Construtor, from the compact binary inference format
+  * \param buffer Start of the serialized tree
+  * \param size Bytes available in buffer
+  * \param threshold_dict Sorted distinct thresholds of each original feature
+  * \param used_size Number of bytes used by this tree
+  */
+  Tree(const char* buffer, size_t size, const std::vector<std::vector<double>>& threshold_dict, size_t* used_size);
+
   ~Tree();
 
   /*!
@@ -165,6 +174,44 @@ public:
   /*! \brief Serialize this object to if-else statement*/
   std::string ToIfElse(int index, bool is_predict_leaf_index) const;
 
+  /*!
+  * \brief Serialize this object to rows of a static node table, used by the node table codegen.
+  *        Internal nodes come first, then one row per leaf whose children point back to itself
+  * \param node_offset Index of this tree's first row in the table
+  * \param feature_slot Slot of each original feature in the dense feature buffer of generated code
+  * \param cat_threshold Bitsets of categorical splits will be appended to it
+  * \return Rows of the node table, num_table_nodes() in total
+  */
+  std::string ToNodeTable(int node_offset, const std::vector<int>& feature_slot,
+                          std::vector<uint32_t>* cat_threshold) const;
+
+  /*!
+  * \brief Add the thresholds of numerical splits to the per-feature threshold dictionary, unsorted
+  * \param threshold_dict Thresholds of each original feature
+  */
+  void AddThresholdsToDict(std::vector<std::vector<double>>* threshold_dict) const;
+
+  /*!
+  * \brief Append this tree in the compact binary inference format. Training-only fields are dropped,
+  *        numerical thresholds become indices into threshold_dict, and child indices, features and
+  *        threshold indices use the smallest integer width that fits this tree
+  * \param threshold_dict Sorted distinct thresholds of each original feature
+  * \param out Buffer to append to
+  */
+  void ToInferenceBinary(const std::vector<std::vector<double>>& threshold_dict, std::string* out) const;
+
+  /*! \brief False if the training-only fields (gains, counts, internal values) were dropped */
+  inline bool has_training_info() const { return num_leaves_ <= 1 || !split_gain_.empty(); }
+
+  /*! \brief Number of rows ToNodeTable emits */
+  inline int num_table_nodes() const { return 2 * num_leaves_ - 1; }
+
+  /*! \brief Number of decisions on the deepest path, 0 for a constant tree */
+  inline int max_depth() const { return num_leaves_ > 1 ? NodeDepth(0) : 0; }
+
+  /*! \brief True if this tree contains categorical splits */
+  inline bool has_categorical() const { return num_cat_ > 0; }
+
   inline static bool IsZero(double fval) {
     if (fval > -kZeroAsMissingValueRange && fval <= kZeroAsMissingValueRange) {
       return true;
@@ -299,6 +346,12 @@ private:
   /*! \brief Serialize one node to if-else statement*/
   std::string NodeToIfElse(int index, bool is_predict_leaf_index) const;
 
+  /*! \brief Depth of the subtree rooted at node, 0 for a leaf */
+  inline int NodeDepth(int node) const {
+    if (node < 0) { return 0; }
+    return 1 + std::max(NodeDepth(left_child_[node]), NodeDepth(right_child_[node]));
+  }
+
   double ExpectedValue() const;
 
   int MaxDepth();
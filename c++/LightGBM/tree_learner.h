@@ -64,6 +64,26 @@ public:
   */
   virtual void AddPredictionToScore(const Tree* tree, double* out_score) const = 0;
 
+  /*!
+  * \brief State of the random generator used for feature sampling
+  */
+  virtual unsigned int GetRandomState() const = 0;
+
+  /*!
+  * \brief Resume the random generator used for feature sampling, e.g. from a checkpoint
+  */
+  virtual void SetRandomState(unsigned int state) = 0;
+
+  /*!
+  * \brief State of the random generator used for stochastic rounding of quantized gradients
+  */
+  virtual unsigned int GetQuantRandomState() const = 0;
+
+  /*!
+  * \brief Resume the random generator used for stochastic rounding of quantized gradients
+  */
+  virtual void SetQuantRandomState(unsigned int state) = 0;
+
   TreeLearner() = default;
   /*! \brief Disable copy */
   TreeLearner& operator=(const TreeLearner&) = delete;
@@ -0,0 +1,170 @@
+#ifndef LIGHTGBM_UTILS_BLOCK_COMPRESSION_H_
+#define LIGHTGBM_UTILS_BLOCK_COMPRESSION_H_
+
+#include <cstdint>
+#include <cstring>
+
+#include <vector>
+
+namespace LightGBM {
+
+/*!
+* \brief Fast LZ77 compression of independent blocks, in the LZ4 block format:
+*        sequences of a token (literal length << 4 | match length - 4), extra length bytes,
+*        the literals, and a 2 bytes little endian offset of the match.
+*        Greedy single-probe matching, like the fast mode of LZ4
+*/
+class BlockCompression {
+public:
+  /*!
+  * \brief Compress a block
+  * \param src Data to compress
+  * \param size Bytes of src
+  * \param out Compressed block, replaces the content
+  */
+  static void Compress(const char* src, size_t size, std::vector<char>* out) {
+    out->clear();
+    out->reserve(size + size / 255 + 16);
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(src);
+    std::vector<uint32_t> table(1 << kHashBits, 0);
+    size_t anchor = 0;
+    size_t pos = 1;
+    // the last match starts kMinTail bytes before the end, and the last kLastLiterals bytes are literals
+    if (size > kMinTail) {
+      const size_t match_limit = size - kMinTail;
+      const size_t match_end_limit = size - kLastLiterals;
+      while (pos < match_limit) {
+        const uint32_t seq = Read32(in + pos);
+        const uint32_t hash = Hash(seq);
+        const size_t ref = table[hash];
+        table[hash] = static_cast<uint32_t>(pos);
+        if (ref >= pos || pos - ref > kMaxOffset || Read32(in + ref) != seq) {
+          ++pos;
+          continue;
+        }
+        size_t match_len = kMinMatch;
+        while (pos + match_len < match_end_limit && in[ref + match_len] == in[pos + match_len]) {
+          ++match_len;
+        }
+        WriteSequence(in + anchor, pos - anchor, pos - ref, match_len, out);
+        pos += match_len;
+        anchor = pos;
+      }
+    }
+    WriteSequence(in + anchor, size - anchor, 0, 0, out);
+  }
+
+  /*!
+  * \brief Decompress a block
+  * \param src Compressed block
+  * \param size Bytes of src
+  * \param out Buffer for the data
+  * \param out_size Bytes of the data
+  * \return False if the block is corrupted or its data doesn't have out_size bytes
+  */
+  static bool Decompress(const char* src, size_t size, char* out, size_t out_size) {
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(src);
+    const uint8_t* in_end = in + size;
+    uint8_t* dst = reinterpret_cast<uint8_t*>(out);
+    uint8_t* dst_end = dst + out_size;
+    while (in < in_end) {
+      const uint8_t token = *in++;
+      size_t literal_len = token >> 4;
+      if (literal_len == 15 && !ReadLength(&in, in_end, &literal_len)) {
+        return false;
+      }
+      if (literal_len > static_cast<size_t>(in_end - in) || literal_len > static_cast<size_t>(dst_end - dst)) {
+        return false;
+      }
+      std::memcpy(dst, in, literal_len);
+      dst += literal_len;
+      in += literal_len;
+      // the last sequence has only literals
+      if (in == in_end) {
+        break;
+      }
+      if (in_end - in < 2) {
+        return false;
+      }
+      const size_t offset = in[0] | (static_cast<size_t>(in[1]) << 8);
+      in += 2;
+      size_t match_len = token & 15;
+      if (match_len == 15 && !ReadLength(&in, in_end, &match_len)) {
+        return false;
+      }
+      match_len += kMinMatch;
+      if (offset == 0 || offset > static_cast<size_t>(dst - reinterpret_cast<uint8_t*>(out))
+          || match_len > static_cast<size_t>(dst_end - dst)) {
+        return false;
+      }
+      // byte by byte, the match can overlap the bytes it writes
+      const uint8_t* ref = dst - offset;
+      for (size_t i = 0; i < match_len; ++i) {
+        dst[i] = ref[i];
+      }
+      dst += match_len;
+    }
+    return dst == dst_end;
+  }
+
+private:
+  static const int kHashBits = 14;
+  static const size_t kMinMatch = 4;
+  static const size_t kMaxOffset = 65535;
+  static const size_t kLastLiterals = 5;
+  static const size_t kMinTail = 12;
+
+  static inline uint32_t Read32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+  }
+
+  static inline uint32_t Hash(uint32_t seq) {
+    return (seq * 2654435761U) >> (32 - kHashBits);
+  }
+
+  static inline void WriteLength(size_t len, std::vector<char>* out) {
+    while (len >= 255) {
+      out->push_back(static_cast<char>(255));
+      len -= 255;
+    }
+    out->push_back(static_cast<char>(len));
+  }
+
+  static inline bool ReadLength(const uint8_t** in, const uint8_t* in_end, size_t* len) {
+    uint8_t byte = 0;
+    do {
+      if (*in >= in_end) {
+        return false;
+      }
+      byte = *(*in)++;
+      *len += byte;
+    } while (byte == 255);
+    return true;
+  }
+
+  /*! \brief Write literals and a match, match_len 0 means the last sequence without a match */
+  static void WriteSequence(const uint8_t* literals, size_t literal_len, size_t offset, size_t match_len,
+                            std::vector<char>* out) {
+    const size_t match_code = match_len > 0 ? match_len - kMinMatch : 0;
+    const uint8_t token = static_cast<uint8_t>(((literal_len < 15 ? literal_len : 15) << 4)
+                                               | (match_code < 15 ? match_code : 15));
+    out->push_back(static_cast<char>(token));
+    if (literal_len >= 15) {
+      WriteLength(literal_len - 15, out);
+    }
+    out->insert(out->end(), reinterpret_cast<const char*>(literals), reinterpret_cast<const char*>(literals) + literal_len);
+    if (match_len > 0) {
+      out->push_back(static_cast<char>(offset & 0xFF));
+      out->push_back(static_cast<char>(offset >> 8));
+      if (match_code >= 15) {
+        WriteLength(match_code - 15, out);
+      }
+    }
+  }
+};
+
+}  // namespace LightGBM
+
+#endif   // LIGHTGBM_UTILS_BLOCK_COMPRESSION_H_
@@ -0,0 +1,103 @@
+#ifndef LIGHTGBM_UTILS_MAPPABLE_VECTOR_H_
+#define LIGHTGBM_UTILS_MAPPABLE_VECTOR_H_
+
+#include <vector>
+
+namespace LightGBM {
+
+/*!
+* \brief Array that either owns its elements in a std::vector, or refers to elements
+*        in memory owned by someone else, e.g. a memory mapped file.
+*        Mapped elements are read only, operations that change the size copy them first
+*/
+template<typename T>
+class MappableVector {
+public:
+  MappableVector() {}
+
+  MappableVector(size_t size, const T& value) : vec_(size, value) {
+    Sync();
+  }
+
+  MappableVector(const MappableVector& other) : vec_(other.data_, other.data_ + other.size_) {
+    Sync();
+  }
+
+  MappableVector& operator=(const MappableVector& other) {
+    if (this != &other) {
+      vec_.assign(other.data_, other.data_ + other.size_);
+      is_mapped_ = false;
+      Sync();
+    }
+    return *this;
+  }
+
+  /*!
+  * \brief Refer to elements owned by someone else
+  * \param data Start of the elements, have to outlive this array
+  * \param size Number of elements
+  */
+  void Map(const T* data, size_t size) {
+    vec_.clear();
+    vec_.shrink_to_fit();
+    data_ = const_cast<T*>(data);
+    size_ = size;
+    is_mapped_ = true;
+  }
+
+  /*! \brief True if the elements are owned by someone else */
+  inline bool is_mapped() const { return is_mapped_; }
+
+  inline T& operator[](size_t i) { return data_[i]; }
+  inline const T& operator[](size_t i) const { return data_[i]; }
+  inline T* data() { return data_; }
+  inline const T* data() const { return data_; }
+  inline size_t size() const { return size_; }
+  inline bool empty() const { return size_ == 0; }
+
+  void resize(size_t size) {
+    Own();
+    vec_.resize(size);
+    Sync();
+  }
+
+  void push_back(const T& value) {
+    Own();
+    vec_.push_back(value);
+    Sync();
+  }
+
+  void clear() {
+    vec_.clear();
+    is_mapped_ = false;
+    Sync();
+  }
+
+  void shrink_to_fit() {
+    Own();
+    vec_.shrink_to_fit();
+    Sync();
+  }
+
+private:
+  void Own() {
+    if (is_mapped_) {
+      vec_.assign(data_, data_ + size_);
+      is_mapped_ = false;
+    }
+  }
+
+  void Sync() {
+    data_ = vec_.data();
+    size_ = vec_.size();
+  }
+
+  std::vector<T> vec_;
+  T* data_ = nullptr;
+  size_t size_ = 0;
+  bool is_mapped_ = false;
+};
+
+}  // namespace LightGBM
+
+#endif   // LIGHTGBM_UTILS_MAPPABLE_VECTOR_H_
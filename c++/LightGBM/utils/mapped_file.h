@@ -0,0 +1,181 @@
+#ifndef LIGHTGBM_UTILS_MAPPED_FILE_H_
+#define LIGHTGBM_UTILS_MAPPED_FILE_H_
+
+#include <cstdio>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace LightGBM {
+
+/*!
+* \brief Read-only view of a whole file, memory mapped when the platform supports it,
+*        otherwise read into a buffer
+*/
+class MappedFile {
+public:
+  /*!
+  * \brief Constructor
+  * \param filename Filename to map
+  * \param is_writable True to map the file copy-on-write, writes never reach the file
+  */
+  explicit MappedFile(const char* filename, bool is_writable = false) {
+#ifndef _WIN32
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+      return;
+    }
+    Map(fd, is_writable);
+    close(fd);
+#else
+    FILE* file;
+#ifdef _MSC_VER
+    fopen_s(&file, filename, "rb");
+#else
+    file = fopen(filename, "rb");
+#endif
+    if (file == NULL) {
+      return;
+    }
+    ReadAll(file);
+    fclose(file);
+#endif
+  }
+
+  /*!
+  * \brief Constructor, view of a file that is already open for reading, e.g. a temporary file without name.
+  *        The file can be closed after this
+  * \param file File to map, from its start
+  */
+  explicit MappedFile(FILE* file) {
+    fflush(file);
+#ifndef _WIN32
+    Map(fileno(file), false);
+#else
+    rewind(file);
+    ReadAll(file);
+#endif
+  }
+
+  /*!
+  * \brief Constructor, view of content that is already in memory, e.g. a decompressed file
+  * \param content Content of the file
+  */
+  explicit MappedFile(std::vector<char>&& content) : buffer_(std::move(content)) {
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+    is_open_ = true;
+  }
+
+  ~MappedFile() {
+#ifndef _WIN32
+    if (is_mapped_) {
+      munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+  }
+
+  /*! \brief True if the file was opened */
+  inline bool is_open() const { return is_open_; }
+  /*! \brief Start of the file content */
+  inline const char* data() const { return data_; }
+  /*! \brief Start of the file content, only valid if opened as writable */
+  inline char* mutable_data() { return const_cast<char*>(data_); }
+  /*! \brief Size of the file in bytes */
+  inline size_t size() const { return size_; }
+
+  /*!
+  * \brief Give the pages fully inside [offset, offset + len) back to the system,
+  *        they are read from the file again (without earlier writes) if touched later
+  * \param offset Start of the range
+  * \param len Length of the range
+  */
+  void Release(size_t offset, size_t len) {
+#ifndef _WIN32
+    if (!is_mapped_) {
+      return;
+    }
+    const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t begin = (offset + page_size - 1) / page_size * page_size;
+    const size_t end = (offset + len) / page_size * page_size;
+    if (begin < end) {
+      madvise(const_cast<char*>(data_) + begin, end - begin, MADV_DONTNEED);
+    }
+#endif
+  }
+
+  /*!
+  * \brief Ask the system to start reading the pages of [offset, offset + len) in the background
+  * \param offset Start of the range
+  * \param len Length of the range
+  */
+  void Prefetch(size_t offset, size_t len) {
+#ifndef _WIN32
+    if (!is_mapped_ || offset >= size_) {
+      return;
+    }
+    const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t begin = offset / page_size * page_size;
+    const size_t end = std::min(offset + len, size_);
+    madvise(const_cast<char*>(data_) + begin, end - begin, MADV_WILLNEED);
+#endif
+  }
+
+  /*! \brief Disable copy */
+  MappedFile& operator=(const MappedFile&) = delete;
+  /*! \brief Disable copy */
+  MappedFile(const MappedFile&) = delete;
+
+private:
+#ifndef _WIN32
+  void Map(int fd, bool is_writable) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      return;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ == 0) {
+      is_open_ = true;
+    } else {
+      const int prot = is_writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+      void* addr = mmap(nullptr, size_, prot, MAP_PRIVATE, fd, 0);
+      if (addr != MAP_FAILED) {
+        data_ = static_cast<const char*>(addr);
+        is_mapped_ = true;
+        is_open_ = true;
+      }
+    }
+  }
+#else
+  void ReadAll(FILE* file) {
+    const size_t buffer_size = 16 * 1024 * 1024;
+    size_t read_cnt = 0;
+    do {
+      buffer_.resize(size_ + buffer_size);
+      read_cnt = fread(buffer_.data() + size_, 1, buffer_size, file);
+      size_ += read_cnt;
+    } while (read_cnt == buffer_size);
+    data_ = buffer_.data();
+    is_open_ = true;
+  }
+#endif
+
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+  bool is_open_ = false;
+  bool is_mapped_ = false;
+  /*! \brief Buffer of the file content when it cannot be mapped */
+  std::vector<char> buffer_;
+};
+
+}  // namespace LightGBM
+
+#endif   // LIGHTGBM_UTILS_MAPPED_FILE_H_
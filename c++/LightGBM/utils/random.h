@@ -93,6 +93,11 @@ public:
     }
     return ret;
   }
+
+  /*! \brief Internal state, can be used to resume the sequence */
+  inline unsigned int state() const { return x; }
+  /*! \brief Resume the sequence from a saved state */
+  inline void set_state(unsigned int state) { x = state; }
 private:
   inline int RandInt16() {
     x = (214013 * x + 2531011);
@@ -2,15 +2,20 @@
 #define LIGHTGBM_UTILS_TEXT_READER_H_
 
 #include <LightGBM/utils/pipeline_reader.h>
+#include <LightGBM/utils/mapped_file.h>
 #include <LightGBM/utils/log.h>
 #include <LightGBM/utils/random.h>
+#include <LightGBM/utils/openmp_wrapper.h>
 
 #include <cstdio>
+#include <cstring>
 #include <sstream>
 
 #include <vector>
 #include <string>
 #include <functional>
+#include <memory>
+#include <algorithm>
 
 namespace LightGBM {
 
@@ -310,6 +315,268 @@ private:
   int skip_bytes_ = 0;
 };
 
+/*!
+* \brief A line of text that lives in a buffer owned by someone else, terminated by '\0'
+*/
+struct TextLine {
+  const char* data;
+  size_t size;
+};
+
+/*!
+* \brief Read text data from a memory mapped file. Lines are not copied,
+*        the line breaks are overwritten by '\0' in a private copy-on-write mapping
+*        and the lines point into it, so the memory used is close to the file size.
+*        The file is split into chunks at line starts and the chunks are scanned by all threads.
+*/
+template<typename INDEX_T>
+class MappedTextReader {
+public:
+  /*!
+  * \brief Constructor
+  * \param filename Filename of data
+  * \param is_skip_first_line True if need to skip header
+  */
+  MappedTextReader(const char* filename, bool is_skip_first_line)
+    :filename_(filename), file_(new MappedFile(filename, true)) {
+    if (!file_->is_open()) {
+      Log::Fatal("Could not open %s", filename);
+    }
+    const char* buffer = file_->data();
+    const size_t size = file_->size();
+    if (is_skip_first_line) {
+      while (skip_bytes_ < size && buffer[skip_bytes_] != '\n' && buffer[skip_bytes_] != '\r') {
+        ++skip_bytes_;
+      }
+      first_line_ = std::string(buffer, skip_bytes_);
+      if (skip_bytes_ < size && buffer[skip_bytes_] == '\r') { ++skip_bytes_; }
+      Log::Debug("Skipped header \"%s\" in file %s", first_line_.c_str(), filename_);
+    }
+    // skip the break between \r and \n
+    if (skip_bytes_ < size && buffer[skip_bytes_] == '\n') { ++skip_bytes_; }
+    // lines end with \n, or with \r for files that only use \r
+    if (skip_bytes_ < size && std::memchr(buffer + skip_bytes_, '\n', size - skip_bytes_) == nullptr) {
+      eol_ = '\r';
+    }
+  }
+  /*!
+  * \brief Destructor
+  */
+  ~MappedTextReader() {
+    Clear();
+  }
+  /*!
+  * \brief Clear the lines and unmap the file, the lines cannot be used after this
+  */
+  inline void Clear() {
+    lines_.clear();
+    lines_.shrink_to_fit();
+    file_.reset(nullptr);
+  }
+  /*!
+  * \brief return first line of data
+  */
+  inline std::string first_line() {
+    return first_line_;
+  }
+  /*!
+  * \brief Get text data that read from file
+  * \return Text data, store in std::vector by line
+  */
+  inline std::vector<TextLine>& Lines() { return lines_; }
+
+  /*!
+  * \brief Read all text data from file in memory
+  * \return number of lines of text data
+  */
+  INDEX_T ReadAllLines() {
+    return ScanLinesParallel(skip_bytes_, file_->size(), &lines_);
+  }
+  /*!
+  * \brief Read part of text data from file in memory, use filter_fun to filter data
+  * \param filter_fun Function that perform data filter
+  * \param out_used_data_indices Store line indices that read text data
+  * \return The number of total data
+  */
+  INDEX_T ReadAndFilterLines(const std::function<bool(INDEX_T)>& filter_fun, std::vector<INDEX_T>* out_used_data_indices) {
+    out_used_data_indices->clear();
+    std::vector<TextLine> all_lines;
+    INDEX_T total_cnt = ScanLinesParallel(skip_bytes_, file_->size(), &all_lines);
+    for (INDEX_T i = 0; i < total_cnt; ++i) {
+      if (filter_fun(i)) {
+        out_used_data_indices->push_back(i);
+        lines_.push_back(all_lines[i]);
+      }
+    }
+    return total_cnt;
+  }
+  /*!
+  * \brief Process the lines block by block, the pages of a block are given back after it is processed
+  * \param process_fun Function that process a block of lines, gets the index of the first used line in the block
+  * \param filter_fun Function that filter lines, gets the number of used lines and the line index
+  * \return The number of total data
+  */
+  INDEX_T ReadAllAndProcessParallelWithFilter(const std::function<void(INDEX_T, const std::vector<TextLine>&)>& process_fun,
+                                              const std::function<bool(INDEX_T, INDEX_T)>& filter_fun) {
+    const size_t block_size = 16 * 1024 * 1024;
+    const size_t size = file_->size();
+    INDEX_T total_cnt = 0;
+    INDEX_T used_cnt = 0;
+    std::vector<TextLine> block_lines;
+    size_t block_start = skip_bytes_;
+    while (block_start < size) {
+      size_t block_end = size;
+      if (size - block_start > block_size) {
+        block_end = NextLineStart(block_start + block_size);
+      }
+      // the next block is read by the system while this one is processed
+      file_->Prefetch(block_end, block_size);
+      INDEX_T cnt = ScanLinesParallel(block_start, block_end, &block_lines);
+      INDEX_T start_idx = used_cnt;
+      lines_.clear();
+      for (INDEX_T i = 0; i < cnt; ++i) {
+        if (filter_fun(used_cnt, total_cnt + i)) {
+          lines_.push_back(block_lines[i]);
+          ++used_cnt;
+        }
+      }
+      total_cnt += cnt;
+      if (!lines_.empty()) {
+        process_fun(start_idx, lines_);
+      }
+      lines_.clear();
+      file_->Release(block_start, block_end - block_start);
+      block_start = block_end;
+    }
+    return total_cnt;
+  }
+
+  INDEX_T ReadAllAndProcessParallel(const std::function<void(INDEX_T, const std::vector<TextLine>&)>& process_fun) {
+    return ReadAllAndProcessParallelWithFilter(process_fun, [](INDEX_T, INDEX_T) { return true; });
+  }
+
+  INDEX_T ReadPartAndProcessParallel(const std::vector<INDEX_T>& used_data_indices, const std::function<void(INDEX_T, const std::vector<TextLine>&)>& process_fun) {
+    return ReadAllAndProcessParallelWithFilter(process_fun,
+      [&used_data_indices](INDEX_T used_cnt, INDEX_T total_cnt) {
+      return static_cast<size_t>(used_cnt) < used_data_indices.size() && total_cnt == used_data_indices[used_cnt];
+    });
+  }
+
+  /*! \brief Disable copy */
+  MappedTextReader& operator=(const MappedTextReader&) = delete;
+  /*! \brief Disable copy */
+  MappedTextReader(const MappedTextReader&) = delete;
+
+private:
+  /*!
+  * \brief Start of the first line that starts after pos, the same line starts ScanLines reaches
+  */
+  size_t NextLineStart(size_t pos) const {
+    const char* buffer = file_->data();
+    const size_t size = file_->size();
+    const char* end = static_cast<const char*>(std::memchr(buffer + pos, eol_, size - pos));
+    if (end == nullptr) {
+      return size;
+    }
+    pos = static_cast<size_t>(end - buffer) + 1;
+    while (pos < size && (buffer[pos] == '\n' || buffer[pos] == '\r')) { ++pos; }
+    return pos;
+  }
+
+  /*!
+  * \brief Find the lines starting in [begin, end) with memchr and terminate them in place.
+  *        begin should be a line start. Empty lines are skipped.
+  * \param out_lines Lines found, appended
+  * \return The number of lines
+  */
+  INDEX_T ScanLines(size_t begin, size_t end, std::vector<TextLine>* out_lines) {
+    char* buffer = file_->mutable_data();
+    const size_t size = file_->size();
+    INDEX_T cnt = 0;
+    size_t pos = begin;
+    while (pos < end) {
+      char* line = buffer + pos;
+      char* line_end = static_cast<char*>(std::memchr(line, eol_, size - pos));
+      if (line_end == nullptr) {
+        // last line doesn't contain end of line, no place for '\0' in the mapping
+        Log::Info("Warning: last line of %s has no end of line, still using this line", filename_);
+        last_line_ = std::string(line, size - pos);
+        out_lines->push_back({ last_line_.c_str(), last_line_.size() });
+        ++cnt;
+        break;
+      }
+      size_t next_pos = static_cast<size_t>(line_end - buffer) + 1;
+      // skip end of line
+      while (next_pos < size && (buffer[next_pos] == '\n' || buffer[next_pos] == '\r')) { ++next_pos; }
+      while (line_end > line && line_end[-1] == '\r') { --line_end; }
+      *line_end = '\0';
+      out_lines->push_back({ line, static_cast<size_t>(line_end - line) });
+      ++cnt;
+      pos = next_pos;
+    }
+    return cnt;
+  }
+
+  /*!
+  * \brief Split [begin, end) into chunks at line starts, scan the chunks in parallel
+  *        and concatenate the lines in file order
+  * \param out_lines Lines found, replaces the content
+  * \return The number of lines
+  */
+  INDEX_T ScanLinesParallel(size_t begin, size_t end, std::vector<TextLine>* out_lines) {
+    // chunks smaller than this are not worth a thread
+    const size_t min_chunk_size = 1024 * 1024;
+    int num_threads = 1;
+    #pragma omp parallel
+    #pragma omp master
+    {
+      num_threads = omp_get_num_threads();
+    }
+    int num_chunks = static_cast<int>(std::min(static_cast<size_t>(num_threads),
+                                               (end - begin) / min_chunk_size + 1));
+    out_lines->clear();
+    if (num_chunks <= 1) {
+      return ScanLines(begin, end, out_lines);
+    }
+    std::vector<size_t> chunk_starts(num_chunks + 1, end);
+    chunk_starts[0] = begin;
+    const size_t step = (end - begin) / num_chunks;
+    for (int i = 1; i < num_chunks; ++i) {
+      chunk_starts[i] = std::min(end, NextLineStart(std::max(chunk_starts[i - 1], begin + step * i)));
+    }
+    std::vector<std::vector<TextLine>> chunk_lines(num_chunks);
+    std::vector<size_t> line_offsets(num_chunks + 1, 0);
+    #pragma omp parallel for schedule(static, 1)
+    for (int i = 0; i < num_chunks; ++i) {
+      ScanLines(chunk_starts[i], chunk_starts[i + 1], &chunk_lines[i]);
+    }
+    for (int i = 0; i < num_chunks; ++i) {
+      line_offsets[i + 1] = line_offsets[i] + chunk_lines[i].size();
+    }
+    out_lines->resize(line_offsets[num_chunks]);
+    #pragma omp parallel for schedule(static, 1)
+    for (int i = 0; i < num_chunks; ++i) {
+      std::copy(chunk_lines[i].begin(), chunk_lines[i].end(), out_lines->begin() + line_offsets[i]);
+    }
+    return static_cast<INDEX_T>(line_offsets[num_chunks]);
+  }
+
+  /*! \brief Filename of text data */
+  const char* filename_;
+  /*! \brief Mapping of the file, lines point into it */
+  std::unique_ptr<MappedFile> file_;
+  /*! \brief Lines of text data */
+  std::vector<TextLine> lines_;
+  /*! \brief Copy of the last line if it has no end of line */
+  std::string last_line_;
+  /*! \brief first line */
+  std::string first_line_ = "";
+  /*! \brief Bytes of the header */
+  size_t skip_bytes_ = 0;
+  /*! \brief Character that ends a line */
+  char eol_ = '\n';
+};
+
 }  // namespace LightGBM
 
 #endif   // LightGBM_UTILS_TEXT_READER_H_
@@ -0,0 +1,480 @@
+#ifndef LIGHTGBM_WINDOW_FEATURE_H_
+#define LIGHTGBM_WINDOW_FEATURE_H_
+
+#include <LightGBM/meta.h>
+#include <LightGBM/utils/log.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace LightGBM {
+
+/*!
+* \brief Features of the raw window corpus written by wakati.py --make_data.
+*        A line is "head o tail" for a boundary and "head x tail" for no boundary.
+*        Every character of the window without the marker is one feature,
+*        keyed by its position and the character like "<pos><char>" in idf_index
+*/
+class WindowFeature {
+public:
+  /*! \brief Key of the character codepoint at position pos of the window */
+  static inline uint64_t Key(int pos, uint32_t codepoint) {
+    return (static_cast<uint64_t>(pos) << 32) | codepoint;
+  }
+
+  /*!
+  * \brief Decode one UTF-8 character, invalid bytes are decoded as U+FFFD one by one
+  * \param str Start of the character
+  * \param size Bytes left in the string, > 0
+  * \param out_codepoint Decoded character
+  * \return Bytes used by the character
+  */
+  static inline size_t DecodeUtf8(const char* str, size_t size, uint32_t* out_codepoint) {
+    const unsigned char c = static_cast<unsigned char>(str[0]);
+    size_t len = 0;
+    uint32_t cp = 0;
+    if (c < 0x80) {
+      *out_codepoint = c;
+      return 1;
+    } else if ((c & 0xE0) == 0xC0) {
+      len = 2; cp = c & 0x1F;
+    } else if ((c & 0xF0) == 0xE0) {
+      len = 3; cp = c & 0x0F;
+    } else if ((c & 0xF8) == 0xF0) {
+      len = 4; cp = c & 0x07;
+    } else {
+      *out_codepoint = 0xFFFD;
+      return 1;
+    }
+    if (len > size) {
+      *out_codepoint = 0xFFFD;
+      return 1;
+    }
+    for (size_t i = 1; i < len; ++i) {
+      const unsigned char cc = static_cast<unsigned char>(str[i]);
+      if ((cc & 0xC0) != 0x80) {
+        *out_codepoint = 0xFFFD;
+        return 1;
+      }
+      cp = (cp << 6) | (cc & 0x3F);
+    }
+    *out_codepoint = cp;
+    return len;
+  }
+
+  /*! \brief Append the UTF-8 bytes of codepoint to out */
+  static inline void EncodeUtf8(uint32_t codepoint, std::string* out) {
+    if (codepoint < 0x80) {
+      out->push_back(static_cast<char>(codepoint));
+    } else if (codepoint < 0x800) {
+      out->push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+      out->push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    } else if (codepoint < 0x10000) {
+      out->push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+      out->push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+      out->push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    } else {
+      out->push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+      out->push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+      out->push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+      out->push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    }
+  }
+
+  /*! \brief Key as "<pos><char>" */
+  static std::string KeyToString(uint64_t key) {
+    std::string str = std::to_string(static_cast<int>(key >> 32));
+    EncodeUtf8(static_cast<uint32_t>(key & 0xFFFFFFFF), &str);
+    return str;
+  }
+
+  /*!
+  * \brief Parse "<pos><char>", the character is the last one of the string
+  * \return False if str is not a key
+  */
+  static bool StringToKey(const char* str, size_t size, uint64_t* out_key) {
+    if (size < 2) { return false; }
+    size_t char_start = size - 1;
+    while (char_start > 0 && size - char_start < 4
+           && (static_cast<unsigned char>(str[char_start]) & 0xC0) == 0x80) {
+      --char_start;
+    }
+    uint32_t codepoint = 0;
+    if (char_start == 0 || DecodeUtf8(str + char_start, size - char_start, &codepoint) != size - char_start) {
+      return false;
+    }
+    int pos = 0;
+    for (size_t i = 0; i < char_start; ++i) {
+      if (str[i] < '0' || str[i] > '9') { return false; }
+      pos = pos * 10 + (str[i] - '0');
+    }
+    *out_key = Key(pos, codepoint);
+    return true;
+  }
+
+  /*! \brief Mix the bits of key, the splitmix64 finalizer */
+  static inline uint64_t Hash(uint64_t key) {
+    key += 0x9E3779B97F4A7C15ULL;
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+    return key ^ (key >> 31);
+  }
+
+  /*! \brief Hashed id of key, in [0, 2^num_hash_bits) */
+  static inline int HashedId(uint64_t key, int num_hash_bits) {
+    return static_cast<int>(Hash(key) & ((1ULL << num_hash_bits) - 1));
+  }
+
+  /*!
+  * \brief Hashed features of the characters of a window, used the same way for training and prediction.
+  *        The id of the character at position j is HashedId(Key(j, c)), the value is 1,
+  *        or +-1 by the top bit of the hash if is_signed. Values of the same id are summed
+  * \param codepoints Characters of the window
+  * \param num_hash_bits Ids are in [0, 2^num_hash_bits)
+  * \param is_signed True to sign the values, so colliding keys cancel out instead of adding up
+  * \param out_features Features sorted by id, ids with a sum of 0 are left out
+  */
+  static void HashFeatures(const std::vector<uint32_t>& codepoints, int num_hash_bits, bool is_signed,
+                           std::vector<std::pair<int, double>>* out_features) {
+    out_features->clear();
+    for (size_t j = 0; j < codepoints.size(); ++j) {
+      const uint64_t hash = Hash(Key(static_cast<int>(j), codepoints[j]));
+      const int id = static_cast<int>(hash & ((1ULL << num_hash_bits) - 1));
+      const double value = (is_signed && (hash >> 63) != 0) ? -1.0f : 1.0f;
+      out_features->emplace_back(id, value);
+    }
+    std::sort(out_features->begin(), out_features->end());
+    size_t out = 0;
+    for (size_t i = 0; i < out_features->size(); ++i) {
+      if (out > 0 && (*out_features)[out - 1].first == (*out_features)[i].first) {
+        (*out_features)[out - 1].second += (*out_features)[i].second;
+      } else {
+        (*out_features)[out++] = (*out_features)[i];
+      }
+    }
+    out_features->resize(out);
+    out_features->erase(std::remove_if(out_features->begin(), out_features->end(),
+      [](const std::pair<int, double>& feature) { return feature.second == 0.0f; }), out_features->end());
+  }
+
+  /*!
+  * \brief Parse one line of the raw corpus, like wakati.py --make_sparse
+  * \param line Line without the end of line
+  * \param size Bytes of the line
+  * \param buffer Buffer for the line without the marker, reused between calls
+  * \param out_codepoints Characters of the window without the marker
+  * \return Label, 0 if the line has the " x " marker, otherwise 1
+  */
+  static double ParseLine(const char* line, size_t size, std::string* buffer,
+                          std::vector<uint32_t>* out_codepoints) {
+    // strip
+    while (size > 0 && IsSpace(line[0])) { ++line; --size; }
+    while (size > 0 && IsSpace(line[size - 1])) { --size; }
+    buffer->assign(line, size);
+    const bool has_x = buffer->find(" x ") != std::string::npos;
+    RemoveAll(" x ", buffer);
+    RemoveAll(" o ", buffer);
+    out_codepoints->clear();
+    size_t i = 0;
+    while (i < buffer->size()) {
+      uint32_t codepoint = 0;
+      i += DecodeUtf8(buffer->data() + i, buffer->size() - i, &codepoint);
+      out_codepoints->push_back(codepoint);
+    }
+    return has_x ? 0.0 : 1.0;
+  }
+
+private:
+  static inline bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+  }
+
+  /*! \brief Remove all non-overlapping pattern, left to right like str.replace */
+  static void RemoveAll(const char* pattern, std::string* str) {
+    const size_t len = std::strlen(pattern);
+    size_t pos = str->find(pattern);
+    if (pos == std::string::npos) { return; }
+    size_t out = pos;
+    while (pos != std::string::npos) {
+      const size_t next = str->find(pattern, pos + len);
+      const size_t end = (next == std::string::npos) ? str->size() : next;
+      for (size_t i = pos + len; i < end; ++i) {
+        (*str)[out++] = (*str)[i];
+      }
+      pos = next;
+    }
+    str->resize(out);
+  }
+};
+
+/*!
+* \brief Dense ids of the window feature keys, the replacement of idf_index.pkl.
+*        Ids are given in the order the keys are added, which is the order the keys
+*        first appear in the corpus for an index built by WindowFeatureCounter.
+*        The file has one "<pos><char>\t<id>" line per key, ordered by id
+*/
+class WindowFeatureIndex {
+public:
+  /*! \brief Id of key, -1 if the key is unknown */
+  inline int Get(uint64_t key) const {
+    auto it = ids_.find(key);
+    return it == ids_.end() ? -1 : it->second;
+  }
+
+  /*! \brief Add key if it is unknown, return its id */
+  inline int Add(uint64_t key) {
+    auto ret = ids_.emplace(key, static_cast<int>(keys_.size()));
+    if (ret.second) {
+      keys_.push_back(key);
+    }
+    return ret.first->second;
+  }
+
+  /*! \brief Number of keys */
+  inline int size() const { return static_cast<int>(keys_.size()); }
+
+  /*! \brief Key of id */
+  inline uint64_t key(int id) const { return keys_[id]; }
+
+  /*!
+  * \brief Load the index
+  * \return False if the file cannot be opened
+  */
+  bool LoadFromFile(const char* filename) {
+    FILE* file;
+#ifdef _MSC_VER
+    fopen_s(&file, filename, "rb");
+#else
+    file = fopen(filename, "rb");
+#endif
+    if (file == NULL) {
+      return false;
+    }
+    ids_.clear();
+    keys_.clear();
+    std::vector<bool> is_used;
+    char buf[256];
+    while (fgets(buf, sizeof(buf), file) != NULL) {
+      size_t len = std::strlen(buf);
+      while (len > 0 && (buf[len - 1] == '\n' || buf[len - 1] == '\r')) { --len; }
+      if (len == 0) { continue; }
+      const char* tab = nullptr;
+      for (size_t i = len; i > 0; --i) {
+        if (buf[i - 1] == '\t') { tab = buf + i - 1; break; }
+      }
+      uint64_t key = 0;
+      if (tab == nullptr || !WindowFeature::StringToKey(buf, tab - buf, &key)) {
+        Log::Fatal("Malformed line \"%.*s\" in feature index %s", static_cast<int>(len), buf, filename);
+      }
+      const int id = std::atoi(tab + 1);
+      if (id < 0 || ids_.count(key) > 0 || (static_cast<size_t>(id) < is_used.size() && is_used[id])) {
+        Log::Fatal("Duplicated key or id in line \"%.*s\" of feature index %s", static_cast<int>(len), buf, filename);
+      }
+      if (static_cast<size_t>(id) >= keys_.size()) {
+        keys_.resize(id + 1);
+        is_used.resize(id + 1, false);
+      }
+      keys_[id] = key;
+      is_used[id] = true;
+      ids_.emplace(key, id);
+    }
+    fclose(file);
+    if (ids_.size() != keys_.size()) {
+      Log::Fatal("Feature index %s has gaps in its ids", filename);
+    }
+    return true;
+  }
+
+  /*! \brief Save the index */
+  void SaveToFile(const char* filename) const {
+    FILE* file;
+#ifdef _MSC_VER
+    fopen_s(&file, filename, "wb");
+#else
+    file = fopen(filename, "wb");
+#endif
+    if (file == NULL) {
+      Log::Fatal("Cannot write feature index to %s", filename);
+    }
+    for (size_t i = 0; i < keys_.size(); ++i) {
+      std::string line = WindowFeature::KeyToString(keys_[i]);
+      fprintf(file, "%s\t%d\n", line.c_str(), static_cast<int>(i));
+    }
+    fclose(file);
+  }
+
+  /*!
+  * \brief Save the ids of each position as one line, the keys of a position are mutually
+  *        exclusive since a window has one character there. Usable as feature_group_file
+  */
+  void SaveGroupsToFile(const char* filename) const {
+    FILE* file;
+#ifdef _MSC_VER
+    fopen_s(&file, filename, "wb");
+#else
+    file = fopen(filename, "wb");
+#endif
+    if (file == NULL) {
+      Log::Fatal("Cannot write feature groups to %s", filename);
+    }
+    std::map<int, std::vector<int>> ids_by_pos;
+    for (size_t i = 0; i < keys_.size(); ++i) {
+      ids_by_pos[static_cast<int>(keys_[i] >> 32)].push_back(static_cast<int>(i));
+    }
+    for (const auto& pos_ids : ids_by_pos) {
+      std::string line;
+      for (int id : pos_ids.second) {
+        if (!line.empty()) { line.push_back(' '); }
+        line += std::to_string(id);
+      }
+      fprintf(file, "%s\n", line.c_str());
+    }
+    fclose(file);
+  }
+
+private:
+  /*! \brief Key to id */
+  std::unordered_map<uint64_t, int> ids_;
+  /*! \brief Id to key */
+  std::vector<uint64_t> keys_;
+};
+
+/*!
+* \brief Occurrences of the window feature keys, counted in thread-local tables by all threads
+*        and merged at the end, so lines can be counted in any order by any thread
+*/
+class WindowFeatureCounter {
+public:
+  /*! \brief Constructor of a counter without threads, assign one with threads before counting */
+  WindowFeatureCounter() {}
+
+  /*! \brief Constructor, tid of Add has to be less than num_threads */
+  explicit WindowFeatureCounter(int num_threads) : thread_stats_(num_threads) {}
+
+  /*! \brief Count one occurrence of key in line line_idx by thread tid */
+  inline void Add(int tid, uint64_t key, data_size_t line_idx) {
+    Stat& stat = thread_stats_[tid][key];
+    if (stat.count == 0 || line_idx < stat.first_line) {
+      stat.first_line = line_idx;
+    }
+    ++stat.count;
+  }
+
+  /*! \brief Merge the thread-local tables, call it once after all lines are counted */
+  void Merge() {
+    for (auto& table : thread_stats_) {
+      for (const auto& pair : table) {
+        Stat& stat = stats_[pair.first];
+        if (stat.count == 0 || pair.second.first_line < stat.first_line) {
+          stat.first_line = pair.second.first_line;
+        }
+        stat.count += pair.second.count;
+      }
+      std::unordered_map<uint64_t, Stat>().swap(table);
+    }
+    keys_.clear();
+    keys_.reserve(stats_.size());
+    for (const auto& pair : stats_) {
+      keys_.push_back(pair.first);
+    }
+    // keys in the order they first appear, by position inside a line
+    std::sort(keys_.begin(), keys_.end(), [this](uint64_t a, uint64_t b) {
+      const data_size_t line_a = stats_[a].first_line;
+      const data_size_t line_b = stats_[b].first_line;
+      if (line_a != line_b) { return line_a < line_b; }
+      return a >> 32 < b >> 32;
+    });
+  }
+
+  /*! \brief Number of different keys */
+  inline int size() const { return static_cast<int>(keys_.size()); }
+
+  /*!
+  * \brief Give ids to the keys that appear at least min_count times, in the order they first appear
+  *        as if the lines were read one by one, so the ids don't depend on the number of threads
+  */
+  void BuildIndex(int64_t min_count, WindowFeatureIndex* out_index) const {
+    for (uint64_t key : keys_) {
+      if (stats_.at(key).count >= min_count) {
+        out_index->Add(key);
+      }
+    }
+  }
+
+  /*!
+  * \brief Log how the keys fall into 2^num_hash_bits hashed ids:
+  *        the ids used, and the keys and occurrences that share their id with another key
+  * \param num_lines Number of lines the keys were counted from, for the log
+  */
+  void LogHashCollisions(int num_hash_bits, data_size_t num_lines) const {
+    std::unordered_map<int, int> keys_per_id;
+    for (uint64_t key : keys_) {
+      ++keys_per_id[WindowFeature::HashedId(key, num_hash_bits)];
+    }
+    int num_colliding_keys = 0;
+    int64_t total_cnt = 0;
+    int64_t colliding_cnt = 0;
+    for (uint64_t key : keys_) {
+      const int64_t cnt = stats_.at(key).count;
+      total_cnt += cnt;
+      if (keys_per_id[WindowFeature::HashedId(key, num_hash_bits)] > 1) {
+        ++num_colliding_keys;
+        colliding_cnt += cnt;
+      }
+    }
+    Log::Info("Hashed %d keys of %d sampled lines into %d of %d ids, %d keys (%.2f%% of occurrences) share their id with another key",
+              size(), num_lines, static_cast<int>(keys_per_id.size()), 1 << num_hash_bits, num_colliding_keys,
+              total_cnt > 0 ? 100.0 * colliding_cnt / total_cnt : 0.0);
+  }
+
+  /*!
+  * \brief Save "<pos><char>\t<count>\t<id>" lines of all keys, the most frequent first,
+  *        id is -1 for the keys left out of index
+  */
+  void SaveStatsToFile(const char* filename, const WindowFeatureIndex& index) const {
+    FILE* file;
+#ifdef _MSC_VER
+    fopen_s(&file, filename, "wb");
+#else
+    file = fopen(filename, "wb");
+#endif
+    if (file == NULL) {
+      Log::Fatal("Cannot write feature stats to %s", filename);
+    }
+    std::vector<uint64_t> keys(keys_);
+    std::stable_sort(keys.begin(), keys.end(), [this](uint64_t a, uint64_t b) {
+      return stats_.at(a).count > stats_.at(b).count;
+    });
+    for (uint64_t key : keys) {
+      std::string str = WindowFeature::KeyToString(key);
+      fprintf(file, "%s\t%lld\t%d\n", str.c_str(),
+              static_cast<long long>(stats_.at(key).count), index.Get(key));
+    }
+    fclose(file);
+  }
+
+private:
+  struct Stat {
+    int64_t count = 0;
+    data_size_t first_line = 0;
+  };
+  /*! \brief Counts of each thread */
+  std::vector<std::unordered_map<uint64_t, Stat>> thread_stats_;
+  /*! \brief Merged counts */
+  std::unordered_map<uint64_t, Stat> stats_;
+  /*! \brief Keys in the order they first appear */
+  std::vector<uint64_t> keys_;
+};
+
+}  // namespace LightGBM
+
+#endif   // LIGHTGBM_WINDOW_FEATURE_H_
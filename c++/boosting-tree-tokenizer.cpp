@@ -8,11 +8,15 @@
 //#include "../gbdt_prediction.cpp"
 //#include "idf_index.cpp"
 #include "./src/application/predictor.hpp"
+#include "./LightGBM/window_feature.h"
+
+// feature ids are hashed the same way as lightgbm task=build_dataset feature_hash_bits=20,
+// so idf_index is not needed
+const int kFeatureHashBits = 20;
+const bool kIsFeatureHashSigned = false;
 
 void tokenize(const std::string& input) {
-  int maxIndex = 0;
-  //for(auto [key, val]:idf_index) 
-  //  if( val > maxIndex ) maxIndex = val;
+  int maxIndex = 1 << kFeatureHashBits;
   std::cout << "maxIndex: " << maxIndex << std::endl; 
 
   std::wcout.imbue(std::locale(""));
@@ -33,8 +37,12 @@ void tokenize(const std::string& input) {
     for(int j=i; j < i + 10; j++ ) {
       std::string key = std::to_string(j-i) + contain[j];
       std::cout << "sample " << key << std::endl;
-      //int cursol = idf_index[key];
-      //inserts[cursol] = 1.0;
+    }
+    std::vector<uint32_t> codepoints(wsmessage.begin() + i, wsmessage.begin() + i + 10);
+    std::vector<std::pair<int, double>> features;
+    LightGBM::WindowFeature::HashFeatures(codepoints, kFeatureHashBits, kIsFeatureHashSigned, &features);
+    for(auto& feature:features) {
+      inserts[feature.first] = feature.second;
     }
     //std::cout << "PREDICT: " << predict(&inserts[0]) << std::endl;
   }
@@ -10,6 +10,7 @@
 #include <LightGBM/objective_function.h>
 #include <LightGBM/prediction_early_stop.h>
 #include <LightGBM/metric.h>
+#include <LightGBM/window_feature.h>
 
 #include "predictor.hpp"
 
@@ -86,8 +87,8 @@ void Application::LoadData() {
   // prediction is needed if using input initial model(continued train)
   PredictFunction predict_fun = nullptr;
   PredictionEarlyStopInstance pred_early_stop = CreatePredictionEarlyStopInstance("none", LightGBM::PredictionEarlyStopConfig());
-  // need to continue training
-  if (boosting_->NumberOfTotalModel() > 0) {
+  // need to continue training, scores come from the checkpoint state if there is one
+  if (boosting_->NumberOfTotalModel() > 0 && checkpoint_state_.empty()) {
     predictor.reset(new Predictor(boosting_.get(), -1, true, false, false, false, -1, -1));
     predict_fun = predictor->GetPredictFunction();
   }
@@ -112,7 +113,7 @@ void Application::LoadData() {
   }
   // need save binary file
   if (config_.io_config.is_save_binary_file) {
-    train_data_->SaveBinaryFile(nullptr);
+    train_data_->SaveBinaryFile(nullptr, config_.io_config.is_save_binary_compressed);
   }
   // create training metric
   if (config_.boosting_config.is_provide_training_metric) {
@@ -141,7 +142,7 @@ void Application::LoadData() {
       valid_datas_.push_back(std::move(new_dataset));
       // need save binary file
       if (config_.io_config.is_save_binary_file) {
-        valid_datas_.back()->SaveBinaryFile(nullptr);
+        valid_datas_.back()->SaveBinaryFile(nullptr, config_.io_config.is_save_binary_compressed);
       }
 
       // add metric for validation data
@@ -185,6 +186,14 @@ void Application::InitTrain() {
   objective_fun_.reset(
     ObjectiveFunction::CreateObjectiveFunction(config_.objective_type,
                                                config_.objective_config));
+  // a snapshot log has its scores saved next to it
+  checkpoint_state_.clear();
+  if (boosting_->NumberOfTotalModel() > 0) {
+    std::string state_filename = config_.io_config.input_model + ".state";
+    if (boosting_->CheckCheckpointState(state_filename.c_str())) {
+      checkpoint_state_ = state_filename;
+    }
+  }
   // load training data
   LoadData();
   // initialize the objective function
@@ -197,15 +206,24 @@ void Application::InitTrain() {
     boosting_->AddValidDataset(valid_datas_[i].get(),
                                Common::ConstPtrInVectorWrapper<Metric>(valid_metrics_[i]));
   }
+  if (!checkpoint_state_.empty()) {
+    boosting_->LoadCheckpointState(checkpoint_state_.c_str());
+  }
   Log::Info("Finished initializing training");
 }
 
 void Application::Train() {
   Log::Info("Started training...");
-  boosting_->Train(config_.io_config.snapshot_freq, config_.io_config.output_model);
+  boosting_->Train(config_.io_config.snapshot_freq, config_.io_config.is_snapshot_log,
+                   config_.io_config.output_model);
   // convert model to if-else statement code
   if (config_.convert_model_language == std::string("cpp")) {
     boosting_->SaveModelToIfElse(-1, config_.io_config.convert_model.c_str());
+  } else if (config_.convert_model_language == std::string("cpp_table")) {
+    boosting_->SaveModelToNodeTable(-1, config_.io_config.convert_model.c_str(),
+                                    config_.io_config.convert_model_benchmark.c_str());
+  } else if (config_.convert_model_language == std::string("inference")) {
+    boosting_->SaveModelToInference(-1, config_.io_config.convert_model.c_str());
   }
   Log::Info("Finished training");
 }
@@ -231,7 +249,45 @@ void Application::ConvertModel() {
   boosting_.reset(
     Boosting::CreateBoosting(config_.boosting_type,
                              config_.io_config.input_model.c_str()));
-  boosting_->SaveModelToIfElse(-1, config_.io_config.convert_model.c_str());
+  if (config_.convert_model_language == std::string("cpp_table")) {
+    boosting_->SaveModelToNodeTable(-1, config_.io_config.convert_model.c_str(),
+                                    config_.io_config.convert_model_benchmark.c_str());
+  } else if (config_.convert_model_language == std::string("inference")) {
+    boosting_->SaveModelToInference(-1, config_.io_config.convert_model.c_str());
+  } else {
+    boosting_->SaveModelToIfElse(-1, config_.io_config.convert_model.c_str());
+  }
+}
+
+std::string Application::FeatureIndexFilename() const {
+  if (config_.io_config.feature_index.empty()) {
+    return config_.io_config.data_filename + ".index";
+  }
+  return config_.io_config.feature_index;
+}
+
+void Application::BuildDataset() {
+  auto start_time = std::chrono::high_resolution_clock::now();
+  const std::string index_filename = FeatureIndexFilename();
+  PredictFunction predict_fun = nullptr;
+  DatasetLoader dataset_loader(config_.io_config, predict_fun, 1, config_.io_config.data_filename.c_str());
+  std::unique_ptr<Dataset> dataset(dataset_loader.LoadFromCorpus(config_.io_config.data_filename.c_str(),
+                                                                 index_filename.c_str()));
+  dataset->SaveBinaryFile(nullptr, config_.io_config.is_save_binary_compressed);
+  auto end_time = std::chrono::high_resolution_clock::now();
+  Log::Info("Finished building dataset in %f seconds",
+            std::chrono::duration<double, std::milli>(end_time - start_time) * 1e-3);
+}
+
+void Application::BuildIndex() {
+  auto start_time = std::chrono::high_resolution_clock::now();
+  PredictFunction predict_fun = nullptr;
+  DatasetLoader dataset_loader(config_.io_config, predict_fun, 1, config_.io_config.data_filename.c_str());
+  WindowFeatureIndex index;
+  dataset_loader.BuildCorpusIndex(config_.io_config.data_filename.c_str(), FeatureIndexFilename().c_str(), &index);
+  auto end_time = std::chrono::high_resolution_clock::now();
+  Log::Info("Finished building feature index in %f seconds",
+            std::chrono::duration<double, std::milli>(end_time - start_time) * 1e-3);
 }
 
 
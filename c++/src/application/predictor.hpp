@@ -9,6 +9,7 @@
 #include <LightGBM/utils/openmp_wrapper.h>
 
 #include <map>
+#include <cmath>
 #include <cstring>
 #include <cstdio>
 #include <vector>
@@ -16,6 +17,7 @@
 #include <functional>
 #include <string>
 #include <memory>
+#include <thread>
 
 namespace LightGBM {
 
@@ -54,6 +56,9 @@ public:
       num_threads_ = omp_get_num_threads();
     }
     boosting->InitPredict(num_iteration);
+    if (is_predict_contrib && !boosting->HasTrainingInfo()) {
+      Log::Fatal("Cannot predict contributions with an inference model, it has no data counts");
+    }
     boosting_ = boosting;
     num_pred_one_row_ = boosting_->NumPredictOneRow(num_iteration, is_predict_leaf_index, is_predict_contrib);
     num_feature_ = boosting_->MaxFeatureIdx() + 1;
@@ -129,7 +134,7 @@ public:
       Log::Fatal("Could not recognize the data format of data file %s.", data_filename);
     }
 
-    TextReader<data_size_t> predict_data_reader(data_filename, has_header);
+    MappedTextReader<data_size_t> predict_data_reader(data_filename, has_header);
     std::unordered_map<int, int> feature_names_map_;
     bool need_adjust = false;
     if(has_header) {
@@ -173,36 +178,101 @@ public:
       }
     };
 
-    std::function<void(data_size_t, const std::vector<std::string>&)> process_fun =
-      [this, &parser_fun, &result_file]
-    (data_size_t, const std::vector<std::string>& lines) {
+    // the results of a block are formatted by each thread into its own buffer, the rows of a thread
+    // are contiguous with schedule(static). A writer thread writes the buffers of a block in order
+    // while the next block is predicted
+    std::vector<std::vector<char>> result_buffers(num_threads_);
+    std::vector<std::vector<char>> write_buffers(num_threads_);
+    std::thread write_worker;
+    bool is_write_failed = false;
+    auto wait_write = [&write_worker] {
+      if (write_worker.joinable()) {
+        write_worker.join();
+      }
+    };
+    std::function<void(data_size_t, const std::vector<TextLine>&)> process_fun =
+      [this, &parser_fun, &result_file, &result_buffers, &write_buffers, &write_worker, &is_write_failed, &wait_write]
+    (data_size_t, const std::vector<TextLine>& lines) {
       std::vector<std::pair<int, double>> oneline_features;
-      std::vector<std::string> result_to_write(lines.size());
+      std::vector<double> result(num_pred_one_row_);
+      for (auto& buffer : result_buffers) {
+        buffer.clear();
+      }
       OMP_INIT_EX();
-      #pragma omp parallel for schedule(static) firstprivate(oneline_features)
+      #pragma omp parallel for schedule(static) firstprivate(oneline_features, result)
       for (data_size_t i = 0; i < static_cast<data_size_t>(lines.size()); ++i) {
         OMP_LOOP_EX_BEGIN();
         oneline_features.clear();
         // parser
-        parser_fun(lines[i].c_str(), &oneline_features);
+        parser_fun(lines[i].data, &oneline_features);
         // predict
-        std::vector<double> result(num_pred_one_row_);
         predict_fun_(oneline_features, result.data());
-        auto str_result = Common::Join<double>(result, "\t");
-        result_to_write[i] = str_result;
+        AppendResult(result, &result_buffers[omp_get_thread_num()]);
         OMP_LOOP_EX_END();
       }
       OMP_THROW_EX();
-      for (data_size_t i = 0; i < static_cast<data_size_t>(result_to_write.size()); ++i) {
-        fprintf(result_file, "%s\n", result_to_write[i].c_str());
-      }
+      wait_write();
+      std::swap(result_buffers, write_buffers);
+      write_worker = std::thread([&write_buffers, result_file, &is_write_failed] {
+        for (const auto& buffer : write_buffers) {
+          if (!buffer.empty() && fwrite(buffer.data(), sizeof(char), buffer.size(), result_file) != buffer.size()) {
+            is_write_failed = true;
+          }
+        }
+      });
     };
-    predict_data_reader.ReadAllAndProcessParallel(process_fun);
+    try {
+      predict_data_reader.ReadAllAndProcessParallel(process_fun);
+    } catch (...) {
+      wait_write();
+      fclose(result_file);
+      throw;
+    }
+    wait_write();
     fclose(result_file);
+    if (is_write_failed) {
+      Log::Fatal("Could not write prediction results to %s", result_filename);
+    }
   }
 
 private:
 
+  /*!
+  * \brief Append a row of results separated by tabs, formatted like Common::Join<double>.
+  *        Integral values (leaf indices) skip snprintf, others keep %.17g so the output is unchanged
+  */
+  static void AppendResult(const std::vector<double>& result, std::vector<char>* out) {
+    char buffer[32];
+    for (size_t i = 0; i < result.size(); ++i) {
+      if (i > 0) {
+        out->push_back('\t');
+      }
+      const double value = result[i];
+      if (value == std::floor(value) && std::fabs(value) < 1e15 && !(value == 0.0 && std::signbit(value))) {
+        // prints like %.17g for integers up to 1e15
+        int64_t integer = static_cast<int64_t>(value);
+        const bool is_negative = integer < 0;
+        if (is_negative) {
+          integer = -integer;
+        }
+        char* end = buffer + sizeof(buffer);
+        char* ptr = end;
+        do {
+          *--ptr = static_cast<char>('0' + integer % 10);
+          integer /= 10;
+        } while (integer > 0);
+        if (is_negative) {
+          *--ptr = '-';
+        }
+        out->insert(out->end(), ptr, end);
+        continue;
+      }
+      const int len = snprintf(buffer, sizeof(buffer), "%.17g", value);
+      out->insert(out->end(), buffer, buffer + len);
+    }
+    out->push_back('\n');
+  }
+
   void CopyToPredictBuffer(double* pred_buf, const std::vector<std::pair<int, double>>& features) {
     int loop_size = static_cast<int>(features.size());
     for (int i = 0; i < loop_size; ++i) {
@@ -4,6 +4,8 @@
 #include "goss.hpp"
 #include "rf.hpp"
 
+#include <LightGBM/utils/mapped_file.h>
+
 namespace LightGBM {
 
 std::string GetBoostingTypeFromModelFile(const char* filename) {
@@ -13,6 +15,14 @@ std::string GetBoostingTypeFromModelFile(const char* filename) {
 }
 
 bool Boosting::LoadFileToBoosting(Boosting* boosting, const char* filename) {
+  if (boosting != nullptr && GetBoostingTypeFromModelFile(filename) == std::string("tree_inference")) {
+    // binary after the header, cannot go through the line reader
+    MappedFile model_file(filename);
+    if (!model_file.is_open()) {
+      Log::Fatal("Could not open %s", filename);
+    }
+    return boosting->LoadModelFromString(std::string(model_file.data(), model_file.size()));
+  }
   if (boosting != nullptr) {
     TextReader<size_t> model_reader(filename, true);
     model_reader.ReadAllLines();
@@ -42,7 +52,7 @@ Boosting* Boosting::CreateBoosting(const std::string& type, const char* filename
   } else {
     std::unique_ptr<Boosting> ret;
     auto type_in_file = GetBoostingTypeFromModelFile(filename);
-    if (type_in_file == std::string("tree")) {
+    if (type_in_file == std::string("tree") || type_in_file == std::string("tree_inference")) {
       if (type == std::string("gbdt")) {
         ret.reset(new GBDT());
       } else if (type == std::string("dart")) {
@@ -65,7 +75,7 @@ Boosting* Boosting::CreateBoosting(const std::string& type, const char* filename
 Boosting* Boosting::CreateBoosting(const char* filename) {
   auto type = GetBoostingTypeFromModelFile(filename);
   std::unique_ptr<Boosting> ret;
-  if (type == std::string("tree")) {
+  if (type == std::string("tree") || type == std::string("tree_inference")) {
     ret.reset(new GBDT());
   } else {
     Log::Fatal("unknown submodel type in model file %s", filename);
@@ -39,6 +39,7 @@ GBDT::GBDT() : iter_(0),
     num_iteration_for_pred_(0),
     shrinkage_rate_(0.1f),
     num_init_iteration_(0),
+    num_snapshot_models_(-1),
     need_re_bagging_(false) {
 
   #pragma omp parallel
@@ -66,6 +67,8 @@ void GBDT::Init(const BoostingConfig* config, const Dataset* train_data, const O
                 const std::vector<const Metric*>& training_metrics) {
   CHECK(train_data != nullptr);
   CHECK(train_data->num_features() > 0);
+  // continued training needs all the loaded trees
+  LoadModelsUntil(NumberOfTotalModel());
   train_data_ = train_data;
   iter_ = 0;
   num_iteration_for_pred_ = 0;
@@ -334,7 +337,7 @@ double ObtainAutomaticInitialScore(const ObjectiveFunction* fobj, const float* l
   }
 }
 
-void GBDT::Train(int snapshot_freq, const std::string& model_output_path) {
+void GBDT::Train(int snapshot_freq, bool is_snapshot_log, const std::string& model_output_path) {
   bool is_finished = false;
   auto start_time = std::chrono::steady_clock::now();
   for (int iter = 0; iter < gbdt_config_->num_iterations && !is_finished; ++iter) {
@@ -348,8 +351,13 @@ void GBDT::Train(int snapshot_freq, const std::string& model_output_path) {
               std::milli>(end_time - start_time) * 1e-3, iter + 1);
     if (snapshot_freq > 0
         && (iter + 1) % snapshot_freq == 0) {
-      std::string snapshot_out = model_output_path + ".snapshot_iter_" + std::to_string(iter + 1);
-      SaveModelToFile(-1, snapshot_out.c_str());
+      if (is_snapshot_log) {
+        std::string snapshot_out = model_output_path + ".snapshot_log";
+        AppendSnapshotToFile(snapshot_out.c_str());
+      } else {
+        std::string snapshot_out = model_output_path + ".snapshot_iter_" + std::to_string(iter + 1);
+        SaveModelToFile(-1, snapshot_out.c_str());
+      }
     }
   }
   SaveModelToFile(-1, model_output_path.c_str());
@@ -48,6 +48,8 @@ public:
   */
   void MergeFrom(const Boosting* other) override {
     auto other_gbdt = reinterpret_cast<const GBDT*>(other);
+    other_gbdt->LoadModelsUntil(other_gbdt->NumberOfTotalModel());
+    LoadModelsUntil(NumberOfTotalModel());
     // tmp move to other vector
     auto original_models = std::move(models_);
     models_ = std::vector<std::unique_ptr<Tree>>();
@@ -91,9 +93,10 @@ public:
   /*!
   * \brief Perform a full training procedure
   * \param snapshot_freq frequence of snapshot
+  * \param is_snapshot_log True to append snapshots to one log instead of writing full models
   * \param model_output_path path of model file
   */
-  void Train(int snapshot_freq, const std::string& model_output_path) override;
+  void Train(int snapshot_freq, bool is_snapshot_log, const std::string& model_output_path) override;
 
   /*!
   * \brief Training logic
@@ -111,7 +114,7 @@ public:
   /*!
   * \brief Get current iteration
   */
-  int GetCurrentIteration() const override { return static_cast<int>(models_.size()) / num_tree_per_iteration_; }
+  int GetCurrentIteration() const override { return NumberOfTotalModel() / num_tree_per_iteration_; }
 
   /*!
   * \brief Can use early stopping for prediction or not
@@ -216,6 +219,30 @@ public:
   */
   bool SaveModelToIfElse(int num_iteration, const char* filename) const override;
 
+  /*!
+  * \brief Translate model to static node tables with a sparse-input traversal kernel
+  * \param num_iteration Number of iterations that want to translate, -1 means translate all
+  * \return C++ codes of model
+  */
+  std::string ModelToNodeTable(int num_iteration) const override;
+
+  /*!
+  * \brief Translate model to static node tables and save it
+  * \param num_iteration Number of iterations that want to translate, -1 means translate all
+  * \param filename Filename that want to save to
+  * \param benchmark_filename Filename of the generated benchmark, empty means no benchmark
+  * \return true if succeeded
+  */
+  bool SaveModelToNodeTable(int num_iteration, const char* filename, const char* benchmark_filename) const override;
+
+  /*!
+  * \brief Save model to the compact binary inference format
+  * \param num_iteration Number of iterations that want to save, -1 means save all
+  * \param filename Filename that want to save to
+  * \return true if succeeded
+  */
+  bool SaveModelToInference(int num_iteration, const char* filename) const override;
+
   /*!
   * \brief Save model to file
   * \param num_iterations Number of model that want to save, -1 means save all
@@ -232,7 +259,27 @@ public:
   virtual std::string SaveModelToString(int num_iterations) const override;
 
   /*!
-  * \brief Restore from a serialized string
+  * \brief Append the trees added since the last snapshot to a snapshot log,
+  *        and save the checkpoint state next to it (filename + ".state").
+  *        The log is started over on the first snapshot of a run
+  * \param filename Filename of the snapshot log
+  * \return true if succeeded
+  */
+  bool AppendSnapshotToFile(const char* filename);
+
+  /*!
+  * \brief Save scores, bagging and iteration counters to a binary checkpoint state
+  * \param filename Filename of the checkpoint state
+  * \return true if succeeded
+  */
+  bool SaveCheckpointState(const char* filename) const;
+
+  bool CheckCheckpointState(const char* filename) const override;
+
+  bool LoadCheckpointState(const char* filename) override;
+
+  /*!
+  * \brief Restore from a serialized string, a snapshot log is replayed up to its last complete checkpoint
   */
   bool LoadModelFromString(const std::string& model_str) override;
 
@@ -254,7 +301,15 @@ public:
   * \brief Get feature names of this model
   * \return Feature names of this model
   */
-  inline std::vector<std::string> FeatureNames() const override { return feature_names_; }
+  inline std::vector<std::string> FeatureNames() const override {
+    if (!feature_names_.empty()) { return feature_names_; }
+    // inference models don't store default names
+    std::vector<std::string> feature_names(max_feature_idx_ + 1);
+    for (int i = 0; i <= max_feature_idx_; ++i) {
+      feature_names[i] = "Column_" + std::to_string(i);
+    }
+    return feature_names;
+  }
 
   /*!
   * \brief Get index of label column
@@ -266,7 +321,11 @@ public:
   * \brief Get number of weak sub-models
   * \return Number of weak sub-models
   */
-  inline int NumberOfTotalModel() const override { return static_cast<int>(models_.size()); }
+  inline int NumberOfTotalModel() const override {
+    std::lock_guard<std::mutex> lock(lazy_mutex_);
+    if (lazy_tree_offsets_.empty()) { return static_cast<int>(models_.size()); }
+    return static_cast<int>(lazy_tree_offsets_.size()) - 1;
+  }
 
   /*!
   * \brief Get number of tree per iteration
@@ -281,19 +340,30 @@ public:
   inline int NumberOfClasses() const override { return num_class_; }
 
   inline void InitPredict(int num_iteration) override {
-    num_iteration_for_pred_ = static_cast<int>(models_.size()) / num_tree_per_iteration_;
+    num_iteration_for_pred_ = NumberOfTotalModel() / num_tree_per_iteration_;
     if (num_iteration > 0) {
       num_iteration_for_pred_ = std::min(num_iteration, num_iteration_for_pred_);
     }
+    // only the trees used by this prediction are parsed
+    LoadModelsUntil(num_iteration_for_pred_ * num_tree_per_iteration_);
+  }
+
+  inline bool HasTrainingInfo() const override {
+    for (int i = 0; i < num_iteration_for_pred_ * num_tree_per_iteration_; ++i) {
+      if (!models_[i]->has_training_info()) { return false; }
+    }
+    return true;
   }
 
   inline double GetLeafValue(int tree_idx, int leaf_idx) const override {
+    LoadModelsUntil(tree_idx + 1);
     CHECK(tree_idx >= 0 && static_cast<size_t>(tree_idx) < models_.size());
     CHECK(leaf_idx >= 0 && leaf_idx < models_[tree_idx]->num_leaves());
     return models_[tree_idx]->LeafOutput(leaf_idx);
   }
 
   inline void SetLeafValue(int tree_idx, int leaf_idx, double val) override {
+    LoadModelsUntil(tree_idx + 1);
     CHECK(tree_idx >= 0 && static_cast<size_t>(tree_idx) < models_.size());
     CHECK(leaf_idx >= 0 && leaf_idx < models_[tree_idx]->num_leaves());
     models_[tree_idx]->SetLeafOutput(leaf_idx, val);
@@ -358,6 +428,30 @@ protected:
 
   double BoostFromAverage();
 
+  /*!
+  * \brief Header of the model file, everything before the trees
+  */
+  std::string ModelHeaderToString() const;
+
+  /*!
+  * \brief Parse the trees of a loaded model up to num_models, the others stay unparsed
+  *        until a later call needs them
+  * \param num_models Number of models that should be available in models_
+  */
+  void LoadModelsUntil(int num_models) const;
+
+  /*!
+  * \brief Parse the model header, everything before the trees
+  * \param lines Lines of the header
+  * \param is_inference True for the inference model, which may omit feature names and infos
+  */
+  bool LoadModelHeader(const std::vector<std::string>& lines, bool is_inference);
+
+  /*!
+  * \brief Restore from the binary inference format, which starts with "tree_inference"
+  */
+  bool LoadInferenceModelFromString(const std::string& model_str);
+
   /*! \brief current iteration */
   int iter_;
   /*! \brief Pointer to training data */
@@ -384,8 +478,14 @@ protected:
   std::vector<std::vector<double>> best_score_;
   /*! \brief output message of best iteration */
   std::vector<std::vector<std::string>> best_msg_;
-  /*! \brief Trained models(trees) */
-  std::vector<std::unique_ptr<Tree>> models_;
+  /*! \brief Trained models(trees), models loaded from text are appended lazily by LoadModelsUntil */
+  mutable std::vector<std::unique_ptr<Tree>> models_;
+  /*! \brief Text of the loaded model, kept until all of its trees are parsed */
+  mutable std::string lazy_model_str_;
+  /*! \brief Offsets of each unparsed "Tree=" block in lazy_model_str_, plus the end; empty if all parsed */
+  mutable std::vector<size_t> lazy_tree_offsets_;
+  /*! \brief Guard of lazy loading */
+  mutable std::mutex lazy_mutex_;
   /*! \brief Max feature index of training data*/
   int max_feature_idx_;
   /*! \brief First order derivative of training data */
@@ -412,6 +512,8 @@ protected:
   double shrinkage_rate_;
   /*! \brief Number of loaded initial models */
   int num_init_iteration_;
+  /*! \brief Number of models already in the snapshot log, -1 means no log was written in this run */
+  int num_snapshot_models_;
   /*! \brief Feature names */
   std::vector<std::string> feature_names_;
   std::vector<std::string> feature_infos_;
@@ -3,14 +3,25 @@
 #include <LightGBM/utils/common.h>
 #include <LightGBM/objective_function.h>
 #include <LightGBM/metric.h>
+#include <LightGBM/utils/mapped_file.h>
+#include <LightGBM/utils/openmp_wrapper.h>
 
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <limits>
 #include <sstream>
 #include <string>
 #include <vector>
 
 namespace LightGBM {
 
+/*! \brief Max depth of trees the node table codegen can traverse without data-dependent branches */
+const int kNodeTableMaxPredicatedDepth = 8;
+
 std::string GBDT::DumpModel(int num_iteration) const {
+  LoadModelsUntil(num_iteration > 0 ? num_iteration * num_tree_per_iteration_ : NumberOfTotalModel());
   std::stringstream str_buf;
 
   str_buf << "{";
@@ -21,7 +32,7 @@ std::string GBDT::DumpModel(int num_iteration) const {
   str_buf << "\"max_feature_idx\":" << max_feature_idx_ << "," << std::endl;
 
   str_buf << "\"feature_names\":[\""
-    << Common::Join(feature_names_, "\",\"") << "\"],"
+    << Common::Join(FeatureNames(), "\",\"") << "\"],"
     << std::endl;
 
   str_buf << "\"tree_info\":[";
@@ -46,6 +57,7 @@ std::string GBDT::DumpModel(int num_iteration) const {
 }
 
 std::string GBDT::ModelToIfElse(int num_iteration) const {
+  LoadModelsUntil(num_iteration > 0 ? num_iteration * num_tree_per_iteration_ : NumberOfTotalModel());
   std::stringstream str_buf;
 
   str_buf << "#include \"gbdt.h\"" << std::endl;
@@ -166,7 +178,330 @@ bool GBDT::SaveModelToIfElse(int num_iteration, const char* filename) const {
   return (bool)output_file;
 }
 
-std::string GBDT::SaveModelToString(int num_iteration) const {
+std::string GBDT::ModelToNodeTable(int num_iteration) const {
+  LoadModelsUntil(num_iteration > 0 ? num_iteration * num_tree_per_iteration_ : NumberOfTotalModel());
+  std::stringstream str_buf;
+  str_buf << std::setprecision(std::numeric_limits<double>::digits10 + 2);
+
+  int num_used_model = static_cast<int>(models_.size());
+  if (num_iteration > 0) {
+    num_used_model = std::min(num_iteration * num_tree_per_iteration_, num_used_model);
+  }
+
+  // only the features used by splits get a slot in the dense buffer of the generated code
+  std::vector<int> feature_slot(max_feature_idx_ + 1, -1);
+  for (int i = 0; i < num_used_model; ++i) {
+    for (int j = 0; j < models_[i]->num_leaves() - 1; ++j) {
+      feature_slot[models_[i]->split_feature(j)] = 0;
+    }
+  }
+  int num_used_feature = 0;
+  for (size_t i = 0; i < feature_slot.size(); ++i) {
+    if (feature_slot[i] >= 0) {
+      feature_slot[i] = num_used_feature++;
+    }
+  }
+
+  std::stringstream node_buf;
+  node_buf << std::setprecision(std::numeric_limits<double>::digits10 + 2);
+  std::vector<uint32_t> cat_threshold;
+  std::vector<int> tree_root(num_used_model);
+  std::vector<int> tree_depth(num_used_model);
+  int num_node = 0;
+  for (int i = 0; i < num_used_model; ++i) {
+    tree_root[i] = num_node;
+    tree_depth[i] = models_[i]->has_categorical() ? -1 : models_[i]->max_depth();
+    node_buf << models_[i]->ToNodeTable(num_node, feature_slot, &cat_threshold);
+    num_node += models_[i]->num_table_nodes();
+  }
+  if (cat_threshold.empty()) {
+    cat_threshold.push_back(0);
+  }
+
+  str_buf << "// Node table model generated by LightGBM, convert_model_language=cpp_table" << std::endl;
+  if (objective_function_ != nullptr) {
+    str_buf << "// objective: " << objective_function_->ToString() << std::endl;
+  }
+  str_buf << "#include <cmath>" << std::endl;
+  str_buf << "#include <cstdint>" << std::endl;
+  str_buf << "#include <vector>" << std::endl;
+  str_buf << std::endl;
+  str_buf << "namespace lightgbm_model {" << std::endl << std::endl;
+  str_buf << "const int kNumFeatures = " << max_feature_idx_ + 1 << ";" << std::endl;
+  str_buf << "const int kNumUsedFeatures = " << num_used_feature << ";" << std::endl;
+  str_buf << "const int kNumTreePerIteration = " << num_tree_per_iteration_ << ";" << std::endl;
+  str_buf << "const int kNumIterations = " << num_used_model / num_tree_per_iteration_ << ";" << std::endl;
+  str_buf << "const int kMaxPredicatedDepth = " << kNodeTableMaxPredicatedDepth << ";" << std::endl;
+  str_buf << "// numerical trees not deeper than this use the branch-free traversal." << std::endl;
+  str_buf << "// Branches are cheaper on sparse one-hot rows, so it is off unless defined at compile time" << std::endl;
+  str_buf << "#ifdef LIGHTGBM_PREDICATED_DEPTH" << std::endl;
+  str_buf << "const int kPredicatedDepth = LIGHTGBM_PREDICATED_DEPTH < kMaxPredicatedDepth ? LIGHTGBM_PREDICATED_DEPTH : kMaxPredicatedDepth;" << std::endl;
+  str_buf << "#else" << std::endl;
+  str_buf << "const int kPredicatedDepth = 0;" << std::endl;
+  str_buf << "#endif" << std::endl;
+  str_buf << "const bool kAverageOutput = " << (average_output_ ? "true" : "false") << ";" << std::endl;
+  str_buf << "const double kZeroAsMissingValueRange = " << kZeroAsMissingValueRange << ";" << std::endl;
+  str_buf << std::endl;
+
+  str_buf << "struct Node {" << std::endl;
+  str_buf << "  double value;          // threshold of a split, output of a leaf" << std::endl;
+  str_buf << "  int32_t child[2];      // left and right row, a leaf points to itself" << std::endl;
+  str_buf << "  int32_t slot;          // slot of the split feature in the dense buffer" << std::endl;
+  str_buf << "  int8_t decision_type;  // same bits as LightGBM::Tree" << std::endl;
+  str_buf << "  int16_t cat_words;     // size of the bitset of a categorical split" << std::endl;
+  str_buf << "};" << std::endl << std::endl;
+
+  str_buf << "// original feature index -> slot, -1 if no split uses the feature" << std::endl;
+  str_buf << "static const int32_t kFeatureSlot[] = {";
+  for (size_t i = 0; i < feature_slot.size(); ++i) {
+    if (i % 32 == 0) { str_buf << std::endl << "  "; }
+    str_buf << feature_slot[i] << ",";
+  }
+  str_buf << std::endl << "};" << std::endl << std::endl;
+
+  str_buf << "static const Node kNodes[] = {" << std::endl;
+  str_buf << node_buf.str();
+  str_buf << "};" << std::endl << std::endl;
+
+  str_buf << "static const int32_t kTreeRoot[] = {" << Common::Join(tree_root, ",") << "};" << std::endl;
+  str_buf << "// depth of numerical trees, -1 for trees with categorical splits" << std::endl;
+  str_buf << "static const int32_t kTreeDepth[] = {" << Common::Join(tree_depth, ",") << "};" << std::endl;
+  str_buf << "static const uint32_t kCatThreshold[] = {" << Common::Join(cat_threshold, ",") << "};" << std::endl;
+  str_buf << std::endl;
+
+  str_buf << "inline bool GoRight(const Node& node, double fval) {" << std::endl;
+  str_buf << "  const int8_t missing_type = (node.decision_type >> 2) & 3;" << std::endl;
+  str_buf << "  const bool is_nan = std::isnan(fval);" << std::endl;
+  str_buf << "  fval = (is_nan && missing_type != 2) ? 0.0 : fval;" << std::endl;
+  str_buf << "  const bool is_missing = (missing_type == 1 && fval > -kZeroAsMissingValueRange && fval <= kZeroAsMissingValueRange)" << std::endl;
+  str_buf << "                          || (missing_type == 2 && is_nan);" << std::endl;
+  str_buf << "  const bool default_left = (node.decision_type & 2) != 0;" << std::endl;
+  str_buf << "  return is_missing ? !default_left : !(fval <= node.value);" << std::endl;
+  str_buf << "}" << std::endl << std::endl;
+
+  str_buf << "inline bool GoRightCategorical(const Node& node, double fval) {" << std::endl;
+  str_buf << "  int int_fval = 0;" << std::endl;
+  str_buf << "  if (std::isnan(fval)) {" << std::endl;
+  str_buf << "    if (((node.decision_type >> 2) & 3) == 2) { return true; }" << std::endl;
+  str_buf << "  } else {" << std::endl;
+  str_buf << "    int_fval = static_cast<int>(fval);" << std::endl;
+  str_buf << "    if (int_fval < 0) { return true; }" << std::endl;
+  str_buf << "  }" << std::endl;
+  str_buf << "  const uint32_t* bits = kCatThreshold + static_cast<int>(node.value);" << std::endl;
+  str_buf << "  return !(int_fval / 32 < node.cat_words && ((bits[int_fval / 32] >> (int_fval & 31)) & 1));" << std::endl;
+  str_buf << "}" << std::endl << std::endl;
+
+  str_buf << "inline int32_t Step(int32_t node, const double* fvals) {" << std::endl;
+  str_buf << "  const Node& cur = kNodes[node];" << std::endl;
+  str_buf << "  return cur.child[GoRight(cur, fvals[cur.slot])];" << std::endl;
+  str_buf << "}" << std::endl << std::endl;
+
+  str_buf << "// shallow numerical trees: exactly depth steps, no data-dependent branch" << std::endl;
+  str_buf << "inline double PredictTreePredicated(int32_t node, int32_t depth, const double* fvals) {" << std::endl;
+  str_buf << "  switch (depth) {" << std::endl;
+  for (int d = kNodeTableMaxPredicatedDepth; d > 0; --d) {
+    str_buf << "    case " << d << ": node = Step(node, fvals);  // fall through" << std::endl;
+  }
+  str_buf << "    default: break;" << std::endl;
+  str_buf << "  }" << std::endl;
+  str_buf << "  return kNodes[node].value;" << std::endl;
+  str_buf << "}" << std::endl << std::endl;
+
+  str_buf << "// same decision as LightGBM::Tree, branches are well predicted on sparse one-hot rows" << std::endl;
+  str_buf << "inline int32_t Decision(const Node& node, double fval) {" << std::endl;
+  str_buf << "  if (node.decision_type & 1) {" << std::endl;
+  str_buf << "    return node.child[GoRightCategorical(node, fval)];" << std::endl;
+  str_buf << "  }" << std::endl;
+  str_buf << "  const int8_t missing_type = (node.decision_type >> 2) & 3;" << std::endl;
+  str_buf << "  if (std::isnan(fval) && missing_type != 2) {" << std::endl;
+  str_buf << "    fval = 0.0;" << std::endl;
+  str_buf << "  }" << std::endl;
+  str_buf << "  if ((missing_type == 1 && fval > -kZeroAsMissingValueRange && fval <= kZeroAsMissingValueRange)" << std::endl;
+  str_buf << "      || (missing_type == 2 && std::isnan(fval))) {" << std::endl;
+  str_buf << "    return (node.decision_type & 2) ? node.child[0] : node.child[1];" << std::endl;
+  str_buf << "  }" << std::endl;
+  str_buf << "  if (fval <= node.value) {" << std::endl;
+  str_buf << "    return node.child[0];" << std::endl;
+  str_buf << "  } else {" << std::endl;
+  str_buf << "    return node.child[1];" << std::endl;
+  str_buf << "  }" << std::endl;
+  str_buf << "}" << std::endl << std::endl;
+
+  str_buf << "// deep or categorical trees: walk until a leaf is reached" << std::endl;
+  str_buf << "inline double PredictTreeGeneric(int32_t node, const double* fvals) {" << std::endl;
+  str_buf << "  while (kNodes[node].child[0] != node) {" << std::endl;
+  str_buf << "    node = Decision(kNodes[node], fvals[kNodes[node].slot]);" << std::endl;
+  str_buf << "  }" << std::endl;
+  str_buf << "  return kNodes[node].value;" << std::endl;
+  str_buf << "}" << std::endl << std::endl;
+
+  str_buf << "/*!" << std::endl;
+  str_buf << "* \\brief Raw score of one sparse row" << std::endl;
+  str_buf << "* \\param indices Original feature indices of the non-zero values" << std::endl;
+  str_buf << "* \\param values Non-zero values, nullptr means every value is 1.0" << std::endl;
+  str_buf << "* \\param nnz Number of non-zero values" << std::endl;
+  str_buf << "* \\param output Raw score, kNumTreePerIteration values" << std::endl;
+  str_buf << "* \\param num_iteration Number of used iterations, <= 0 means all" << std::endl;
+  str_buf << "*/" << std::endl;
+  str_buf << "inline void PredictRaw(const int32_t* indices, const double* values, int nnz, double* output," << std::endl;
+  str_buf << "                       int num_iteration = -1) {" << std::endl;
+  str_buf << "  static thread_local std::vector<double> fvals(kNumUsedFeatures + 1, 0.0);" << std::endl;
+  str_buf << "  for (int i = 0; i < nnz; ++i) {" << std::endl;
+  str_buf << "    if (indices[i] >= 0 && indices[i] < kNumFeatures && kFeatureSlot[indices[i]] >= 0) {" << std::endl;
+  str_buf << "      fvals[kFeatureSlot[indices[i]]] = values == nullptr ? 1.0 : values[i];" << std::endl;
+  str_buf << "    }" << std::endl;
+  str_buf << "  }" << std::endl;
+  str_buf << "  int num_iteration_for_pred = kNumIterations;" << std::endl;
+  str_buf << "  if (num_iteration > 0 && num_iteration < kNumIterations) {" << std::endl;
+  str_buf << "    num_iteration_for_pred = num_iteration;" << std::endl;
+  str_buf << "  }" << std::endl;
+  str_buf << "  for (int k = 0; k < kNumTreePerIteration; ++k) {" << std::endl;
+  str_buf << "    output[k] = 0.0;" << std::endl;
+  str_buf << "  }" << std::endl;
+  str_buf << "  for (int i = 0; i < num_iteration_for_pred; ++i) {" << std::endl;
+  str_buf << "    for (int k = 0; k < kNumTreePerIteration; ++k) {" << std::endl;
+  str_buf << "      const int tree = i * kNumTreePerIteration + k;" << std::endl;
+  str_buf << "      if (kTreeDepth[tree] >= 0 && kTreeDepth[tree] <= kPredicatedDepth) {" << std::endl;
+  str_buf << "        output[k] += PredictTreePredicated(kTreeRoot[tree], kTreeDepth[tree], fvals.data());" << std::endl;
+  str_buf << "      } else {" << std::endl;
+  str_buf << "        output[k] += PredictTreeGeneric(kTreeRoot[tree], fvals.data());" << std::endl;
+  str_buf << "      }" << std::endl;
+  str_buf << "    }" << std::endl;
+  str_buf << "  }" << std::endl;
+  str_buf << "  if (kAverageOutput) {" << std::endl;
+  str_buf << "    for (int k = 0; k < kNumTreePerIteration; ++k) {" << std::endl;
+  str_buf << "      output[k] /= num_iteration_for_pred;" << std::endl;
+  str_buf << "    }" << std::endl;
+  str_buf << "  }" << std::endl;
+  str_buf << "  // only the touched slots need to be reset" << std::endl;
+  str_buf << "  for (int i = 0; i < nnz; ++i) {" << std::endl;
+  str_buf << "    if (indices[i] >= 0 && indices[i] < kNumFeatures && kFeatureSlot[indices[i]] >= 0) {" << std::endl;
+  str_buf << "      fvals[kFeatureSlot[indices[i]]] = 0.0;" << std::endl;
+  str_buf << "    }" << std::endl;
+  str_buf << "  }" << std::endl;
+  str_buf << "}" << std::endl << std::endl;
+
+  str_buf << "}  // namespace lightgbm_model" << std::endl;
+
+  return str_buf.str();
+}
+
+std::string NodeTableBenchmarkToString(const std::string& model_filename) {
+  std::stringstream str_buf;
+  auto pos = model_filename.find_last_of("/\\");
+  std::string model_include = pos == std::string::npos ? model_filename : model_filename.substr(pos + 1);
+
+  str_buf << "// Benchmark of the node table model against the interpreted LightGBM predictor, generated by LightGBM" << std::endl;
+  str_buf << "// usage: <this binary> <model.txt> <data.libsvm> [repeat]" << std::endl;
+  str_buf << "// build with -DLIGHTGBM_PREDICATED_DEPTH=<depth> to measure the branch-free traversal of shallow trees" << std::endl;
+  str_buf << "#include <LightGBM/utils/log.h>" << std::endl;
+  str_buf << "#include <LightGBM/c_api.h>" << std::endl;
+  str_buf << "#include \"" << model_include << "\"" << std::endl;
+  str_buf << "#include <chrono>" << std::endl;
+  str_buf << "#include <cmath>" << std::endl;
+  str_buf << "#include <cstdio>" << std::endl;
+  str_buf << "#include <cstdlib>" << std::endl;
+  str_buf << "#include <fstream>" << std::endl;
+  str_buf << "#include <string>" << std::endl;
+  str_buf << "#include <vector>" << std::endl;
+  str_buf << std::endl;
+  str_buf << "int main(int argc, char** argv) {" << std::endl;
+  str_buf << "  if (argc < 3) {" << std::endl;
+  str_buf << "    std::fprintf(stderr, \"usage: %s <model.txt> <data.libsvm> [repeat]\\n\", argv[0]);" << std::endl;
+  str_buf << "    return 1;" << std::endl;
+  str_buf << "  }" << std::endl;
+  str_buf << "  const int repeat = argc > 3 ? std::atoi(argv[3]) : 1;" << std::endl;
+  str_buf << "  // read the rows into CSR" << std::endl;
+  str_buf << "  std::vector<int32_t> indptr(1, 0);" << std::endl;
+  str_buf << "  std::vector<int32_t> indices;" << std::endl;
+  str_buf << "  std::vector<double> values;" << std::endl;
+  str_buf << "  std::ifstream data_file(argv[2]);" << std::endl;
+  str_buf << "  std::string line;" << std::endl;
+  str_buf << "  while (std::getline(data_file, line)) {" << std::endl;
+  str_buf << "    const char* p = line.c_str();" << std::endl;
+  str_buf << "    char* end = nullptr;" << std::endl;
+  str_buf << "    // skip label" << std::endl;
+  str_buf << "    std::strtod(p, &end);" << std::endl;
+  str_buf << "    p = end;" << std::endl;
+  str_buf << "    while (*p != '\\0') {" << std::endl;
+  str_buf << "      const long idx = std::strtol(p, &end, 10);" << std::endl;
+  str_buf << "      if (end == p || *end != ':') { break; }" << std::endl;
+  str_buf << "      p = end + 1;" << std::endl;
+  str_buf << "      const double val = std::strtod(p, &end);" << std::endl;
+  str_buf << "      p = end;" << std::endl;
+  str_buf << "      indices.push_back(static_cast<int32_t>(idx));" << std::endl;
+  str_buf << "      values.push_back(val);" << std::endl;
+  str_buf << "    }" << std::endl;
+  str_buf << "    indptr.push_back(static_cast<int32_t>(indices.size()));" << std::endl;
+  str_buf << "  }" << std::endl;
+  str_buf << "  const int64_t num_row = static_cast<int64_t>(indptr.size()) - 1;" << std::endl;
+  str_buf << "  if (num_row <= 0) {" << std::endl;
+  str_buf << "    std::fprintf(stderr, \"no data in %s\\n\", argv[2]);" << std::endl;
+  str_buf << "    return 1;" << std::endl;
+  str_buf << "  }" << std::endl;
+  str_buf << "  const int num_class = lightgbm_model::kNumTreePerIteration;" << std::endl;
+  str_buf << "  std::vector<double> generated(num_row * num_class);" << std::endl;
+  str_buf << "  std::vector<double> interpreted(num_row * num_class);" << std::endl;
+  str_buf << std::endl;
+  str_buf << "  auto start_time = std::chrono::steady_clock::now();" << std::endl;
+  str_buf << "  for (int r = 0; r < repeat; ++r) {" << std::endl;
+  str_buf << "    for (int64_t i = 0; i < num_row; ++i) {" << std::endl;
+  str_buf << "      lightgbm_model::PredictRaw(indices.data() + indptr[i], values.data() + indptr[i]," << std::endl;
+  str_buf << "                                 indptr[i + 1] - indptr[i], generated.data() + i * num_class);" << std::endl;
+  str_buf << "    }" << std::endl;
+  str_buf << "  }" << std::endl;
+  str_buf << "  const double generated_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();" << std::endl;
+  str_buf << std::endl;
+  str_buf << "  BoosterHandle booster = nullptr;" << std::endl;
+  str_buf << "  int num_iterations = 0;" << std::endl;
+  str_buf << "  if (LGBM_BoosterCreateFromModelfile(argv[1], &num_iterations, &booster) != 0) {" << std::endl;
+  str_buf << "    std::fprintf(stderr, \"%s\\n\", LGBM_GetLastError());" << std::endl;
+  str_buf << "    return 1;" << std::endl;
+  str_buf << "  }" << std::endl;
+  str_buf << "  int64_t out_len = 0;" << std::endl;
+  str_buf << "  start_time = std::chrono::steady_clock::now();" << std::endl;
+  str_buf << "  for (int r = 0; r < repeat; ++r) {" << std::endl;
+  str_buf << "    LGBM_BoosterPredictForCSR(booster, indptr.data(), C_API_DTYPE_INT32, indices.data(), values.data()," << std::endl;
+  str_buf << "                              C_API_DTYPE_FLOAT64, static_cast<int64_t>(indptr.size())," << std::endl;
+  str_buf << "                              static_cast<int64_t>(indices.size()), lightgbm_model::kNumFeatures," << std::endl;
+  str_buf << "                              C_API_PREDICT_RAW_SCORE, lightgbm_model::kNumIterations, \"num_threads=1\"," << std::endl;
+  str_buf << "                              &out_len, interpreted.data());" << std::endl;
+  str_buf << "  }" << std::endl;
+  str_buf << "  const double interpreted_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();" << std::endl;
+  str_buf << "  LGBM_BoosterFree(booster);" << std::endl;
+  str_buf << std::endl;
+  str_buf << "  double max_diff = 0.0;" << std::endl;
+  str_buf << "  for (int64_t i = 0; i < num_row * num_class; ++i) {" << std::endl;
+  str_buf << "    max_diff = std::fmax(max_diff, std::fabs(generated[i] - interpreted[i]));" << std::endl;
+  str_buf << "  }" << std::endl;
+  str_buf << "  const double total_row = static_cast<double>(num_row) * repeat;" << std::endl;
+  str_buf << "  std::printf(\"rows: %lld x %d\\n\", static_cast<long long>(num_row), repeat);" << std::endl;
+  str_buf << "  std::printf(\"generated:   %f s, %.0f rows/s\\n\", generated_sec, total_row / generated_sec);" << std::endl;
+  str_buf << "  std::printf(\"interpreted: %f s, %.0f rows/s\\n\", interpreted_sec, total_row / interpreted_sec);" << std::endl;
+  str_buf << "  std::printf(\"speedup: %.2fx, max abs diff: %g\\n\", interpreted_sec / generated_sec, max_diff);" << std::endl;
+  str_buf << "  return 0;" << std::endl;
+  str_buf << "}" << std::endl;
+
+  return str_buf.str();
+}
+
+bool GBDT::SaveModelToNodeTable(int num_iteration, const char* filename, const char* benchmark_filename) const {
+  std::ofstream output_file(filename);
+  output_file << ModelToNodeTable(num_iteration);
+  output_file.close();
+  if (!output_file) {
+    return false;
+  }
+  if (benchmark_filename != nullptr && benchmark_filename[0] != '\0') {
+    std::ofstream benchmark_file(benchmark_filename);
+    benchmark_file << NodeTableBenchmarkToString(filename);
+    benchmark_file.close();
+    return (bool)benchmark_file;
+  }
+  return true;
+}
+
+std::string GBDT::ModelHeaderToString() const {
   std::stringstream ss;
 
   // output model type
@@ -187,9 +522,23 @@ std::string GBDT::SaveModelToString(int num_iteration) const {
     ss << "average_output" << std::endl;
   }
 
-  ss << "feature_names=" << Common::Join(feature_names_, " ") << std::endl;
+  ss << "feature_names=" << Common::Join(FeatureNames(), " ") << std::endl;
+
+  if (feature_infos_.empty()) {
+    // loaded from an inference model, which doesn't keep the feature ranges
+    ss << "feature_infos=" << Common::Join(std::vector<std::string>(max_feature_idx_ + 1, "none"), " ") << std::endl;
+  } else {
+    ss << "feature_infos=" << Common::Join(feature_infos_, " ") << std::endl;
+  }
+
+  return ss.str();
+}
+
+std::string GBDT::SaveModelToString(int num_iteration) const {
+  LoadModelsUntil(num_iteration > 0 ? num_iteration * num_tree_per_iteration_ : NumberOfTotalModel());
+  std::stringstream ss;
 
-  ss << "feature_infos=" << Common::Join(feature_infos_, " ") << std::endl;
+  ss << ModelHeaderToString();
 
   std::vector<double> feature_importances = FeatureImportance(num_iteration, 0);
 
@@ -238,11 +587,225 @@ bool GBDT::SaveModelToFile(int num_iteration, const char* filename) const {
   return (bool)output_file;
 }
 
-bool GBDT::LoadModelFromString(const std::string& model_str) {
-  // use serialized string to restore this object
-  models_.clear();
-  std::vector<std::string> lines = Common::SplitLines(model_str.c_str());
+bool GBDT::AppendSnapshotToFile(const char* filename) {
+  const int num_models = static_cast<int>(models_.size());
+  // start over when nothing was logged in this run, or trees were removed since the last snapshot.
+  // the new log is written aside and renamed, so the log being resumed from is never half written
+  const bool is_new_log = num_snapshot_models_ < 0 || num_snapshot_models_ > num_models;
+  const std::string out_filename = is_new_log ? std::string(filename) + ".tmp" : std::string(filename);
+  /*! \brief File to write models */
+  std::ofstream output_file;
+  if (is_new_log) {
+    output_file.open(out_filename, std::ios::out | std::ios::trunc);
+    output_file << ModelHeaderToString() << std::endl;
+    num_snapshot_models_ = 0;
+  } else {
+    output_file.open(out_filename, std::ios::out | std::ios::app);
+  }
+  // one checkpoint record: header, new trees, then the end mark which commits the record
+  output_file << "checkpoint_iteration=" << GetCurrentIteration() << std::endl;
+  output_file << "checkpoint_num_models=" << num_models << std::endl;
+  output_file << "checkpoint_num_init_iteration=" << num_init_iteration_ << std::endl;
+  output_file << "checkpoint_num_data=" << num_data_ << std::endl;
+  output_file << std::endl;
+  for (int i = num_snapshot_models_; i < num_models; ++i) {
+    output_file << "Tree=" << i << std::endl;
+    output_file << models_[i]->ToString() << std::endl;
+  }
+  output_file << "end_of_checkpoint=" << GetCurrentIteration() << std::endl << std::endl;
+  output_file.flush();
+  output_file.close();
+  if (!output_file
+      || (is_new_log && std::rename(out_filename.c_str(), filename) != 0)) {
+    Log::Warning("Failed to append snapshot to %s", filename);
+    num_snapshot_models_ = -1;
+    return false;
+  }
+  num_snapshot_models_ = num_models;
+  return SaveCheckpointState((std::string(filename) + ".state").c_str());
+}
+
+namespace {
+
+/*! \brief Magic of the checkpoint state file, followed by the header fields as int64 */
+const char kCheckpointStateMagic[] = "LightGBM.state.2";
+const size_t kCheckpointStateMagicSize = sizeof(kCheckpointStateMagic) - 1;
+
+enum CheckpointStateField {
+  kStateNumModels = 0,
+  kStateNumTreePerIteration,
+  kStateIter,
+  kStateNumInitIteration,
+  kStateNumData,
+  kStateBagDataCnt,
+  kStateNeedReBagging,
+  kStateRandomState,
+  kStateQuantRandomState,
+  kStateNumValid,
+  kNumStateFields
+};
+
+}  // namespace
+
+bool GBDT::SaveCheckpointState(const char* filename) const {
+  // layout: magic, header, valid num_data, train scores, valid scores, bagging indices.
+  // every field before the bagging indices is 8 bytes, so the scores stay aligned when mapped
+  const std::string tmp_filename = std::string(filename) + ".tmp";
+  FILE* file;
+#ifdef _MSC_VER
+  fopen_s(&file, tmp_filename.c_str(), "wb");
+#else
+  file = fopen(tmp_filename.c_str(), "wb");
+#endif
+  if (file == NULL) {
+    Log::Warning("Could not write checkpoint state to %s", filename);
+    return false;
+  }
+  const bool is_bagging_subset = bag_data_cnt_ < num_data_;
+  std::vector<int64_t> header(kNumStateFields);
+  header[kStateNumModels] = static_cast<int64_t>(models_.size());
+  header[kStateNumTreePerIteration] = num_tree_per_iteration_;
+  header[kStateIter] = iter_;
+  header[kStateNumInitIteration] = num_init_iteration_;
+  header[kStateNumData] = num_data_;
+  header[kStateBagDataCnt] = is_bagging_subset ? bag_data_cnt_ : -1;
+  header[kStateNeedReBagging] = need_re_bagging_ ? 1 : 0;
+  header[kStateRandomState] = tree_learner_->GetRandomState();
+  header[kStateQuantRandomState] = tree_learner_->GetQuantRandomState();
+  header[kStateNumValid] = static_cast<int64_t>(valid_score_updater_.size());
+  for (const auto& score_updater : valid_score_updater_) {
+    header.push_back(score_updater->num_data());
+  }
+  bool is_ok = fwrite(kCheckpointStateMagic, 1, kCheckpointStateMagicSize, file) == kCheckpointStateMagicSize;
+  is_ok = is_ok && fwrite(header.data(), sizeof(int64_t), header.size(), file) == header.size();
+  const size_t train_score_size = static_cast<size_t>(num_data_) * num_tree_per_iteration_;
+  is_ok = is_ok && fwrite(train_score_updater_->score(), sizeof(double), train_score_size, file) == train_score_size;
+  for (const auto& score_updater : valid_score_updater_) {
+    const size_t score_size = static_cast<size_t>(score_updater->num_data()) * num_tree_per_iteration_;
+    is_ok = is_ok && fwrite(score_updater->score(), sizeof(double), score_size, file) == score_size;
+  }
+  if (is_bagging_subset) {
+    const size_t bag_size = static_cast<size_t>(bag_data_cnt_);
+    is_ok = is_ok && fwrite(bag_data_indices_.data(), sizeof(data_size_t), bag_size, file) == bag_size;
+  }
+  is_ok = (fclose(file) == 0) && is_ok;
+  if (!is_ok || std::rename(tmp_filename.c_str(), filename) != 0) {
+    Log::Warning("Could not write checkpoint state to %s", filename);
+    return false;
+  }
+  return true;
+}
 
+bool GBDT::CheckCheckpointState(const char* filename) const {
+  FILE* file;
+#ifdef _MSC_VER
+  fopen_s(&file, filename, "rb");
+#else
+  file = fopen(filename, "rb");
+#endif
+  if (file == NULL) {
+    return false;
+  }
+  char magic[kCheckpointStateMagicSize];
+  std::vector<int64_t> header(kNumStateFields);
+  bool is_ok = fread(magic, 1, kCheckpointStateMagicSize, file) == kCheckpointStateMagicSize
+    && std::memcmp(magic, kCheckpointStateMagic, kCheckpointStateMagicSize) == 0
+    && fread(header.data(), sizeof(int64_t), header.size(), file) == header.size();
+  fclose(file);
+  if (!is_ok) {
+    Log::Warning("%s is not a checkpoint state, will re-score the data", filename);
+    return false;
+  }
+  if (header[kStateNumModels] != NumberOfTotalModel()
+      || header[kStateNumTreePerIteration] != num_tree_per_iteration_) {
+    Log::Warning("Checkpoint state %s has %d models, but %d are loaded, will re-score the data",
+                 filename, static_cast<int>(header[kStateNumModels]), NumberOfTotalModel());
+    return false;
+  }
+  return true;
+}
+
+bool GBDT::LoadCheckpointState(const char* filename) {
+  MappedFile mapped_file(filename);
+  if (!mapped_file.is_open()) {
+    Log::Fatal("Could not read checkpoint state %s", filename);
+    return false;
+  }
+  const char* mem_ptr = mapped_file.data();
+  const char* mem_end = mem_ptr + mapped_file.size();
+  auto check_size = [mem_end, filename](const char* ptr, size_t size) {
+    if (static_cast<size_t>(mem_end - ptr) < size) {
+      Log::Fatal("Checkpoint state %s is truncated", filename);
+    }
+  };
+  check_size(mem_ptr, kCheckpointStateMagicSize + sizeof(int64_t) * kNumStateFields);
+  if (std::memcmp(mem_ptr, kCheckpointStateMagic, kCheckpointStateMagicSize) != 0) {
+    Log::Fatal("%s is not a checkpoint state", filename);
+  }
+  mem_ptr += kCheckpointStateMagicSize;
+  std::vector<int64_t> header(kNumStateFields);
+  std::memcpy(header.data(), mem_ptr, sizeof(int64_t) * kNumStateFields);
+  mem_ptr += sizeof(int64_t) * kNumStateFields;
+
+  const size_t num_valid = valid_score_updater_.size();
+  if (header[kStateNumModels] != static_cast<int64_t>(models_.size())
+      || header[kStateNumTreePerIteration] != num_tree_per_iteration_
+      || (header[kStateIter] + header[kStateNumInitIteration]) * num_tree_per_iteration_ != header[kStateNumModels]) {
+    Log::Fatal("Checkpoint state %s doesn't match the loaded models", filename);
+  }
+  if (header[kStateNumData] != num_data_ || header[kStateNumValid] != static_cast<int64_t>(num_valid)) {
+    Log::Fatal("Checkpoint state %s doesn't match the training and validation data", filename);
+  }
+  check_size(mem_ptr, sizeof(int64_t) * num_valid);
+  for (size_t i = 0; i < num_valid; ++i) {
+    int64_t valid_num_data = 0;
+    std::memcpy(&valid_num_data, mem_ptr, sizeof(int64_t));
+    mem_ptr += sizeof(int64_t);
+    if (valid_num_data != valid_score_updater_[i]->num_data()) {
+      Log::Fatal("Checkpoint state %s doesn't match validation data %d", filename, static_cast<int>(i) + 1);
+    }
+  }
+  // scores
+  const size_t train_score_size = sizeof(double) * num_data_ * num_tree_per_iteration_;
+  check_size(mem_ptr, train_score_size);
+  train_score_updater_->LoadScore(reinterpret_cast<const double*>(mem_ptr));
+  mem_ptr += train_score_size;
+  for (auto& score_updater : valid_score_updater_) {
+    const size_t score_size = sizeof(double) * score_updater->num_data() * num_tree_per_iteration_;
+    check_size(mem_ptr, score_size);
+    score_updater->LoadScore(reinterpret_cast<const double*>(mem_ptr));
+    mem_ptr += score_size;
+  }
+  // iteration counters, the next bagging, feature sampling and gradient rounding continue the saved sequences
+  iter_ = static_cast<int>(header[kStateIter]);
+  num_init_iteration_ = static_cast<int>(header[kStateNumInitIteration]);
+  need_re_bagging_ = header[kStateNeedReBagging] != 0;
+  tree_learner_->SetRandomState(static_cast<unsigned int>(header[kStateRandomState]));
+  tree_learner_->SetQuantRandomState(static_cast<unsigned int>(header[kStateQuantRandomState]));
+  if (header[kStateBagDataCnt] >= 0) {
+    if (bag_data_indices_.size() < static_cast<size_t>(num_data_)) {
+      Log::Fatal("Checkpoint state %s was saved with bagging, but bagging is disabled", filename);
+    }
+    bag_data_cnt_ = static_cast<data_size_t>(header[kStateBagDataCnt]);
+    check_size(mem_ptr, sizeof(data_size_t) * bag_data_cnt_);
+    std::memcpy(bag_data_indices_.data(), mem_ptr, sizeof(data_size_t) * bag_data_cnt_);
+    if (!is_use_subset_) {
+      tree_learner_->SetBaggingData(bag_data_indices_.data(), bag_data_cnt_);
+    } else {
+      tmp_subset_->ReSize(bag_data_cnt_);
+      tmp_subset_->CopySubset(train_data_, bag_data_indices_.data(), bag_data_cnt_, false);
+      tree_learner_->ResetTrainingData(tmp_subset_.get());
+    }
+  } else if (bag_data_cnt_ < num_data_) {
+    // saved without a bagging subset, draw one at the next iteration
+    need_re_bagging_ = true;
+  }
+  Log::Info("Restored scores of %d iterations from checkpoint state %s",
+            iter_ + num_init_iteration_, filename);
+  return true;
+}
+
+bool GBDT::LoadModelHeader(const std::vector<std::string>& lines, bool is_inference) {
   // get number of classes
   auto line = Common::FindFromLines(lines, "num_class=");
   if (line.size() > 0) {
@@ -288,6 +851,9 @@ bool GBDT::LoadModelFromString(const std::string& model_str) {
       Log::Fatal("Wrong size of feature_names");
       return false;
     }
+  } else if (is_inference) {
+    // default names are generated on demand
+    feature_names_.clear();
   } else {
     Log::Fatal("Model file doesn't contain feature names");
     return false;
@@ -300,6 +866,8 @@ bool GBDT::LoadModelFromString(const std::string& model_str) {
       Log::Fatal("Wrong size of feature_infos");
       return false;
     }
+  } else if (is_inference) {
+    feature_infos_.clear();
   } else {
     Log::Fatal("Model file doesn't contain feature infos");
     return false;
@@ -312,6 +880,232 @@ bool GBDT::LoadModelFromString(const std::string& model_str) {
     loaded_objective_.reset(ObjectiveFunction::CreateObjectiveFunction(str));
     objective_function_ = loaded_objective_.get();
   }
+  return true;
+}
+
+namespace {
+
+/*! \brief First line of the binary inference model, instead of SubModelName() */
+const char kInferenceModelName[] = "tree_inference";
+/*! \brief Last line of the text header of the binary inference model */
+const char kInferenceHeaderEnd[] = "end_of_header\n";
+
+}  // namespace
+
+bool GBDT::SaveModelToInference(int num_iteration, const char* filename) const {
+  LoadModelsUntil(num_iteration > 0 ? num_iteration * num_tree_per_iteration_ : NumberOfTotalModel());
+  int num_used_model = static_cast<int>(models_.size());
+  if (num_iteration > 0) {
+    num_used_model = std::min(num_iteration * num_tree_per_iteration_, num_used_model);
+  }
+  // distinct thresholds of each feature, one-hot features share a single value across all trees
+  std::vector<std::vector<double>> threshold_dict(max_feature_idx_ + 1);
+  for (int i = 0; i < num_used_model; ++i) {
+    models_[i]->AddThresholdsToDict(&threshold_dict);
+  }
+  int num_dict_feature = 0;
+  size_t num_dict_value = 0;
+  for (auto& dict : threshold_dict) {
+    std::sort(dict.begin(), dict.end());
+    dict.erase(std::unique(dict.begin(), dict.end()), dict.end());
+    if (!dict.empty()) {
+      ++num_dict_feature;
+      num_dict_value += dict.size();
+    }
+  }
+
+  // text header, same fields as the text model without the feature ranges,
+  // and without the feature names when they are the default ones
+  bool is_default_name = true;
+  for (size_t i = 0; i < feature_names_.size() && is_default_name; ++i) {
+    is_default_name = feature_names_[i] == "Column_" + std::to_string(i);
+  }
+  std::string header;
+  for (const auto& line : Common::SplitLines(ModelHeaderToString().c_str())) {
+    if (line == SubModelName() || line.find("feature_infos=") == 0
+        || (is_default_name && line.find("feature_names=") == 0)) {
+      continue;
+    }
+    header += line + "\n";
+  }
+  std::string body;
+  int32_t counts[2] = { num_used_model, num_dict_feature };
+  body.append(reinterpret_cast<const char*>(counts), sizeof(counts));
+  // threshold dictionary: feature, count, values
+  for (size_t fidx = 0; fidx < threshold_dict.size(); ++fidx) {
+    if (threshold_dict[fidx].empty()) { continue; }
+    int32_t entry[2] = { static_cast<int32_t>(fidx), static_cast<int32_t>(threshold_dict[fidx].size()) };
+    body.append(reinterpret_cast<const char*>(entry), sizeof(entry));
+    body.append(reinterpret_cast<const char*>(threshold_dict[fidx].data()), sizeof(double) * threshold_dict[fidx].size());
+  }
+  for (int i = 0; i < num_used_model; ++i) {
+    models_[i]->ToInferenceBinary(threshold_dict, &body);
+  }
+
+  FILE* file;
+#ifdef _MSC_VER
+  fopen_s(&file, filename, "wb");
+#else
+  file = fopen(filename, "wb");
+#endif
+  if (file == NULL) {
+    Log::Fatal("Could not write inference model to %s", filename);
+    return false;
+  }
+  std::string head = std::string(kInferenceModelName) + "\n" + header + kInferenceHeaderEnd;
+  bool is_ok = fwrite(head.data(), 1, head.size(), file) == head.size();
+  is_ok = is_ok && fwrite(body.data(), 1, body.size(), file) == body.size();
+  is_ok = (fclose(file) == 0) && is_ok;
+  Log::Info("Saved %d trees as inference model, %d distinct thresholds over %d features, %zu bytes",
+            num_used_model, static_cast<int>(num_dict_value), num_dict_feature, head.size() + body.size());
+  return is_ok;
+}
+
+bool GBDT::LoadInferenceModelFromString(const std::string& model_str) {
+  size_t header_end = model_str.find(kInferenceHeaderEnd);
+  if (header_end == std::string::npos) {
+    Log::Fatal("Inference model format error, cannot find the end of header");
+    return false;
+  }
+  std::vector<std::string> lines = Common::SplitLines(model_str.substr(0, header_end).c_str());
+  if (!LoadModelHeader(lines, true)) {
+    return false;
+  }
+  const char* ptr = model_str.data() + header_end + std::strlen(kInferenceHeaderEnd);
+  const char* end = model_str.data() + model_str.size();
+  auto take = [&ptr, end](size_t bytes) {
+    if (static_cast<size_t>(end - ptr) < bytes) {
+      Log::Fatal("Inference model format error, model is truncated");
+    }
+    const char* ret = ptr;
+    ptr += bytes;
+    return ret;
+  };
+  int32_t counts[2];
+  std::memcpy(counts, take(sizeof(counts)), sizeof(counts));
+  std::vector<std::vector<double>> threshold_dict(max_feature_idx_ + 1);
+  for (int i = 0; i < counts[1]; ++i) {
+    int32_t entry[2];
+    std::memcpy(entry, take(sizeof(entry)), sizeof(entry));
+    if (entry[0] < 0 || entry[0] > max_feature_idx_ || entry[1] < 0) {
+      Log::Fatal("Inference model format error, wrong threshold dictionary");
+    }
+    auto& dict = threshold_dict[entry[0]];
+    dict.resize(entry[1]);
+    std::memcpy(dict.data(), take(sizeof(double) * entry[1]), sizeof(double) * entry[1]);
+  }
+  models_.reserve(counts[0]);
+  for (int i = 0; i < counts[0]; ++i) {
+    size_t used_size = 0;
+    models_.emplace_back(new Tree(ptr, static_cast<size_t>(end - ptr), threshold_dict, &used_size));
+    ptr += used_size;
+  }
+  Log::Info("Finished loading %d models", models_.size());
+  num_iteration_for_pred_ = static_cast<int>(models_.size()) / num_tree_per_iteration_;
+  num_init_iteration_ = num_iteration_for_pred_;
+  iter_ = 0;
+  return true;
+}
+
+void GBDT::LoadModelsUntil(int num_models) const {
+  std::lock_guard<std::mutex> lock(lazy_mutex_);
+  if (lazy_tree_offsets_.empty()) { return; }
+  const int num_total_model = static_cast<int>(lazy_tree_offsets_.size()) - 1;
+  num_models = std::min(num_models, num_total_model);
+  const int num_loaded = static_cast<int>(models_.size());
+  if (num_models <= num_loaded) { return; }
+  std::vector<std::unique_ptr<Tree>> new_models(num_models - num_loaded);
+  OMP_INIT_EX();
+  #pragma omp parallel for schedule(dynamic, 16)
+  for (int i = num_loaded; i < num_models; ++i) {
+    OMP_LOOP_EX_BEGIN();
+    // skip the "Tree=" line, the block runs until the next tree
+    size_t begin = lazy_model_str_.find('\n', lazy_tree_offsets_[i]);
+    size_t end = lazy_tree_offsets_[i + 1];
+    begin = (begin == std::string::npos || begin > end) ? end : begin + 1;
+    new_models[i - num_loaded].reset(new Tree(lazy_model_str_.substr(begin, end - begin)));
+    OMP_LOOP_EX_END();
+  }
+  OMP_THROW_EX();
+  for (auto& tree : new_models) {
+    models_.push_back(std::move(tree));
+  }
+  Log::Debug("Loaded %d of %d models", num_models, num_total_model);
+  if (num_models == num_total_model) {
+    std::string().swap(lazy_model_str_);
+    std::vector<size_t>().swap(lazy_tree_offsets_);
+  }
+}
+
+bool GBDT::LoadModelFromString(const std::string& model_str) {
+  // use serialized string to restore this object
+  models_.clear();
+  std::string().swap(lazy_model_str_);
+  std::vector<size_t>().swap(lazy_tree_offsets_);
+  if (model_str.compare(0, std::strlen(kInferenceModelName), kInferenceModelName) == 0) {
+    return LoadInferenceModelFromString(model_str);
+  }
+  if (model_str.find("\ncheckpoint_iteration=") == std::string::npos) {
+    // only index where each tree starts, trees are parsed when they are needed, see LoadModelsUntil
+    std::vector<size_t> tree_offsets;
+    size_t pos = model_str.compare(0, 5, "Tree=") == 0 ? 0 : model_str.find("\nTree=");
+    while (pos != std::string::npos) {
+      if (model_str[pos] == '\n') { ++pos; }
+      tree_offsets.push_back(pos);
+      pos = model_str.find("\nTree=", pos);
+    }
+    const size_t header_end = tree_offsets.empty() ? model_str.size() : tree_offsets[0];
+    if (!LoadModelHeader(Common::SplitLines(model_str.substr(0, header_end).c_str()), false)) {
+      return false;
+    }
+    if (!tree_offsets.empty()) {
+      tree_offsets.push_back(model_str.size());
+      lazy_tree_offsets_ = std::move(tree_offsets);
+      lazy_model_str_ = model_str;
+    }
+    Log::Info("Finished indexing %d models", NumberOfTotalModel());
+    num_iteration_for_pred_ = NumberOfTotalModel() / num_tree_per_iteration_;
+    num_init_iteration_ = num_iteration_for_pred_;
+    iter_ = 0;
+    return true;
+  }
+  std::vector<std::string> lines = Common::SplitLines(model_str.c_str());
+
+  // snapshot log: only replay the complete checkpoints, a record cut off by a crash is dropped
+  int num_checkpoint_models = -1;
+  size_t first_checkpoint = lines.size();
+  for (size_t i = 0; i < lines.size(); ++i) {
+    if (lines[i].find("checkpoint_iteration=") == 0) {
+      first_checkpoint = i;
+      break;
+    }
+  }
+  if (first_checkpoint < lines.size()) {
+    size_t log_end = first_checkpoint;
+    for (size_t i = lines.size(); i > first_checkpoint; --i) {
+      if (lines[i - 1].find("end_of_checkpoint=") == 0) {
+        log_end = i;
+        break;
+      }
+    }
+    if (log_end < lines.size()) {
+      Log::Warning("Dropped an incomplete record at the end of the snapshot log");
+    }
+    lines.resize(log_end);
+    for (size_t i = log_end; i > first_checkpoint; --i) {
+      if (lines[i - 1].find("checkpoint_num_models=") == 0) {
+        Common::Atoi(Common::Split(lines[i - 1].c_str(), '=')[1].c_str(), &num_checkpoint_models);
+        break;
+      }
+    }
+    if (num_checkpoint_models < 0) {
+      num_checkpoint_models = 0;
+    }
+  }
+
+  if (!LoadModelHeader(lines, false)) {
+    return false;
+  }
 
   // get tree models
   size_t i = 0;
@@ -328,6 +1122,12 @@ bool GBDT::LoadModelFromString(const std::string& model_str) {
       ++i;
     }
   }
+  if (num_checkpoint_models >= 0
+      && static_cast<int>(models_.size()) != num_checkpoint_models) {
+    Log::Fatal("Snapshot log is corrupted: expected %d models, but found %d",
+               num_checkpoint_models, static_cast<int>(models_.size()));
+    return false;
+  }
   Log::Info("Finished loading %d models", models_.size());
   num_iteration_for_pred_ = static_cast<int>(models_.size()) / num_tree_per_iteration_;
   num_init_iteration_ = num_iteration_for_pred_;
@@ -337,12 +1137,19 @@ bool GBDT::LoadModelFromString(const std::string& model_str) {
 }
 
 std::vector<double> GBDT::FeatureImportance(int num_iteration, int importance_type) const {
+  LoadModelsUntil(num_iteration > 0 ? num_iteration * num_tree_per_iteration_ : NumberOfTotalModel());
 
   int num_used_model = static_cast<int>(models_.size());
   if (num_iteration > 0) {
     num_iteration += 0;
     num_used_model = std::min(num_iteration * num_tree_per_iteration_, num_used_model);
   }
+  for (int iter = 0; iter < num_used_model; ++iter) {
+    if (!models_[iter]->has_training_info()) {
+      Log::Warning("Feature importances are not available for an inference model");
+      return std::vector<double>(max_feature_idx_ + 1, 0.0);
+    }
+  }
 
   std::vector<double> feature_importances(max_feature_idx_ + 1, 0.0);
   if (importance_type == 0) {
@@ -97,6 +97,13 @@ public:
                        data_size_t data_cnt, int cur_tree_id) {
     tree->AddPredictionToScore(data_, data_indices, data_cnt, score_.data() + cur_tree_id * num_data_);
   }
+  /*!
+  * \brief Overwrite all scores, e.g. with the ones saved in a checkpoint
+  * \param score Scores of all trees per iteration, in the same layout as score()
+  */
+  inline void LoadScore(const double* score) {
+    std::memcpy(score_.data(), score, sizeof(double) * score_.size());
+  }
   /*! \brief Pointer of score */
   inline const double* score() const { return score_.data(); }
   inline data_size_t num_data() const { return num_data_; }
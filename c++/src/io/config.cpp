@@ -103,6 +103,10 @@ void GetTaskType(const std::unordered_map<std::string, std::string>& params, Tas
       *task_type = TaskType::kPredict;
     } else if (value == std::string("convert_model")) {
       *task_type = TaskType::kConvertModel;
+    } else if (value == std::string("build_dataset")) {
+      *task_type = TaskType::kBuildDataset;
+    } else if (value == std::string("build_index")) {
+      *task_type = TaskType::kBuildIndex;
     } else {
       Log::Fatal("Unknown task type %s", value.c_str());
     }
@@ -227,13 +231,35 @@ void OverallConfig::CheckParamConflict() {
   } else if (boosting_config.tree_learner_type == std::string("data")
              || boosting_config.tree_learner_type == std::string("voting")) {
     is_parallel_find_bin = true;
-    if (boosting_config.tree_config.histogram_pool_size >= 0
-        && boosting_config.tree_learner_type == std::string("data")) {
-      Log::Warning("Histogram LRU queue was enabled (histogram_pool_size=%f). Will disable this to reduce communication costs"
-        , boosting_config.tree_config.histogram_pool_size);
-      // Change pool size to -1 (no limit) when using data parallel to reduce communication costs
-      boosting_config.tree_config.histogram_pool_size = -1;
+    if (boosting_config.tree_learner_type == std::string("data")) {
+      if (boosting_config.tree_config.histogram_pool_size > 0) {
+        Log::Warning("Histogram LRU queue was enabled (histogram_pool_size=%f). Will disable this to reduce communication costs"
+          , boosting_config.tree_config.histogram_pool_size);
+      }
+      // Change pool size to 0 (no limit, not sized from the memory) when using data parallel to reduce communication costs
+      boosting_config.tree_config.histogram_pool_size = 0;
+    }
+  }
+  // dart rescales trees that are already in the log, appending only the new trees would lose that
+  if (io_config.is_snapshot_log && boosting_type == std::string("dart")) {
+    Log::Fatal("snapshot_log is not supported by dart boosting, use snapshot_freq without it");
+  }
+  if (boosting_config.tree_config.leaf_batch_size > 1
+      && (!is_single_tree_learner || boosting_config.device_type == std::string("gpu"))) {
+    Log::Warning("leaf_batch_size is only supported by the serial cpu tree learner, will grow leaf-wise");
+    boosting_config.tree_config.leaf_batch_size = 1;
+  }
+  if (boosting_config.tree_config.gradient_quant_bits > 0 && boosting_config.device_type == std::string("gpu")) {
+    Log::Warning("gradient_quant_bits is not supported by the gpu tree learner, will not quantize gradients");
+    boosting_config.tree_config.gradient_quant_bits = 0;
+  }
+  // the other learners use the ordered bins, which are not created for row-wise histograms
+  if (!is_single_tree_learner || boosting_config.device_type == std::string("gpu")) {
+    if (boosting_config.tree_config.force_row_wise) {
+      Log::Warning("force_row_wise is only supported by the serial cpu tree learner, will construct histograms by feature groups");
+      boosting_config.tree_config.force_row_wise = false;
     }
+    boosting_config.tree_config.force_col_wise = true;
   }
   // Check max_depth and num_leaves
   if (boosting_config.tree_config.max_depth > 0) {
@@ -259,15 +285,26 @@ void IOConfig::Set(const std::unordered_map<std::string, std::string>& params) {
   GetBool(params, "is_enable_sparse", &is_enable_sparse);
   GetDouble(params, "sparse_threshold", &sparse_threshold);
   GetBool(params, "use_two_round_loading", &use_two_round_loading);
+  GetBool(params, "use_streaming_loading", &use_streaming_loading);
+  GetString(params, "spool_dir", &spool_dir);
   GetBool(params, "is_save_binary_file", &is_save_binary_file);
+  GetBool(params, "is_save_binary_compressed", &is_save_binary_compressed);
+  GetString(params, "feature_index", &feature_index);
+  GetInt(params, "min_feature_count", &min_feature_count);
+  CHECK(min_feature_count > 0);
+  GetInt(params, "feature_hash_bits", &feature_hash_bits);
+  CHECK(feature_hash_bits >= 0 && feature_hash_bits <= 30);
+  GetBool(params, "is_feature_hash_signed", &is_feature_hash_signed);
   GetBool(params, "enable_load_from_binary_file", &enable_load_from_binary_file);
   GetBool(params, "is_predict_raw_score", &is_predict_raw_score);
   GetBool(params, "is_predict_leaf_index", &is_predict_leaf_index);
   GetBool(params, "is_predict_contrib", &is_predict_contrib);
   GetInt(params, "snapshot_freq", &snapshot_freq);
+  GetBool(params, "is_snapshot_log", &is_snapshot_log);
   GetString(params, "output_model", &output_model);
   GetString(params, "input_model", &input_model);
   GetString(params, "convert_model", &convert_model);
+  GetString(params, "convert_model_benchmark", &convert_model_benchmark);
   GetString(params, "output_result", &output_result);
   std::string tmp_str = "";
   if (GetString(params, "valid_data", &tmp_str)) {
@@ -290,6 +327,7 @@ void IOConfig::Set(const std::unordered_map<std::string, std::string>& params) {
   CHECK(min_data_in_bin > 0);
   GetDouble(params, "max_conflict_rate", &max_conflict_rate);
   GetBool(params, "enable_bundle", &enable_bundle);
+  GetString(params, "feature_group_file", &feature_group_file);
 
   GetBool(params, "pred_early_stop", &pred_early_stop);
   GetInt(params, "pred_early_stop_freq", &pred_early_stop_freq);
@@ -375,6 +413,8 @@ void TreeConfig::Set(const std::unordered_map<std::string, std::string>& params)
   GetDouble(params, "feature_fraction", &feature_fraction);
   CHECK(feature_fraction > 0.0f && feature_fraction <= 1.0f);
   GetDouble(params, "histogram_pool_size", &histogram_pool_size);
+  GetDouble(params, "histogram_pool_sparse_fraction", &histogram_pool_sparse_fraction);
+  CHECK(histogram_pool_sparse_fraction >= 0.0f && histogram_pool_sparse_fraction < 1.0f);
   GetInt(params, "max_depth", &max_depth);
   GetInt(params, "top_k", &top_k);
   GetInt(params, "gpu_platform_id", &gpu_platform_id);
@@ -390,6 +430,15 @@ void TreeConfig::Set(const std::unordered_map<std::string, std::string>& params)
   CHECK(cat_smooth >= 1);
   CHECK(min_data_per_group > 0);
   CHECK(max_cat_to_onehot > 0);
+  GetInt(params, "gradient_quant_bits", &gradient_quant_bits);
+  CHECK(gradient_quant_bits == 0 || (gradient_quant_bits >= 2 && gradient_quant_bits <= 16));
+  GetBool(params, "force_row_wise", &force_row_wise);
+  GetBool(params, "force_col_wise", &force_col_wise);
+  CHECK(!(force_row_wise && force_col_wise));
+  GetInt(params, "leaf_batch_size", &leaf_batch_size);
+  CHECK(leaf_batch_size > 0);
+  GetDouble(params, "leaf_batch_min_gain_ratio", &leaf_batch_min_gain_ratio);
+  CHECK(leaf_batch_min_gain_ratio >= 0.0f && leaf_batch_min_gain_ratio <= 1.0f);
 }
 
 void BoostingConfig::Set(const std::unordered_map<std::string, std::string>& params) {
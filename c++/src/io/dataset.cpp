@@ -3,11 +3,15 @@
 #include <LightGBM/utils/openmp_wrapper.h>
 #include <LightGBM/utils/threading.h>
 #include <LightGBM/utils/array_args.h>
+#include <LightGBM/utils/block_compression.h>
+#include <LightGBM/utils/text_reader.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cstdio>
 #include <unordered_map>
 #include <limits>
+#include <numeric>
 #include <vector>
 #include <utility>
 #include <string>
@@ -15,7 +19,8 @@
 
 namespace LightGBM {
 
-const char* Dataset::binary_file_token = "______LightGBM_Binary_File_Token______\n";
+const char* Dataset::binary_file_token = "______LightGBM_Binary_File_Token_v2___\n";
+const char* Dataset::compressed_binary_file_token = "______LightGBM_Binary_File_Token_v2lz_\n";
 
 Dataset::Dataset() {
   data_filename_ = "noname";
@@ -209,6 +214,109 @@ std::vector<std::vector<int>> FastFeatureBundling(std::vector<std::unique_ptr<Bi
   return ret;
 }
 
+/*!
+* \brief Load the declared exclusive feature sets of used features, one group per set.
+*        A set is split when it has more bins than a GPU group can have
+* \param rest_features Used features, the features of the groups are removed
+*/
+std::vector<std::vector<int>> LoadFeatureGroups(const char* filename,
+                                                const std::vector<std::unique_ptr<BinMapper>>& bin_mappers,
+                                                bool is_use_gpu,
+                                                std::vector<int>* rest_features) {
+  const int gpu_max_bin_per_group = 256;
+  TextReader<size_t> reader(filename, false);
+  reader.ReadAllLines();
+  if (reader.Lines().empty()) {
+    Log::Fatal("Cannot read feature groups from %s", filename);
+  }
+  const int num_total_features = static_cast<int>(bin_mappers.size());
+  std::vector<bool> is_used(num_total_features, false);
+  for (int fidx : *rest_features) {
+    is_used[fidx] = true;
+  }
+  std::vector<bool> is_grouped(num_total_features, false);
+  std::vector<std::vector<int>> features_in_group;
+  for (const auto& line : reader.Lines()) {
+    int group_num_bin = 0;
+    features_in_group.emplace_back();
+    for (const auto& token : Common::Split(line.c_str(), " \t,")) {
+      int fidx = 0;
+      if (!Common::AtoiAndCheck(token.c_str(), &fidx) || fidx < 0) {
+        Log::Fatal("Malformed feature index \"%s\" in feature groups %s", token.c_str(), filename);
+      }
+      // not in data, or trivial
+      if (fidx >= num_total_features || !is_used[fidx]) { continue; }
+      if (is_grouped[fidx]) {
+        Log::Fatal("Feature %d is in more than one set of feature groups %s", fidx, filename);
+      }
+      is_grouped[fidx] = true;
+      const int num_bin = bin_mappers[fidx]->num_bin() + (bin_mappers[fidx]->GetDefaultBin() == 0 ? -1 : 0);
+      if (is_use_gpu && !features_in_group.back().empty() && group_num_bin + num_bin > gpu_max_bin_per_group) {
+        features_in_group.emplace_back();
+        group_num_bin = 0;
+      }
+      features_in_group.back().push_back(fidx);
+      group_num_bin += num_bin;
+    }
+    if (features_in_group.back().empty()) {
+      features_in_group.pop_back();
+    }
+  }
+  rest_features->erase(std::remove_if(rest_features->begin(), rest_features->end(), [&is_grouped] (int fidx) {
+    return is_grouped[fidx];
+  }), rest_features->end());
+  return features_in_group;
+}
+
+/*!
+* \brief Check the declared groups on the sampled non-zero rows, the conflicts are counted like FindGroups.
+*        A group that is not exclusive is dropped and its features are bundled as usual
+* \param rest_features Used features that are not in a group, the features of dropped groups are added back
+*/
+void CheckFeatureGroups(const char* filename,
+                        int** sample_indices,
+                        const int* num_per_col,
+                        size_t total_sample_cnt,
+                        data_size_t max_error_cnt,
+                        std::vector<std::vector<int>>* features_in_group,
+                        std::vector<int>* rest_features) {
+  // the feature that marked each sampled row, -1 if none
+  std::vector<int> row_feature(total_sample_cnt, -1);
+  std::vector<std::vector<int>> exclusive_groups;
+  for (const auto& features : *features_in_group) {
+    data_size_t conflict_cnt = 0;
+    int conflict_fidx = -1;
+    int conflict_other_fidx = -1;
+    for (int fidx : features) {
+      for (int i = 0; i < num_per_col[fidx]; ++i) {
+        const int row = sample_indices[fidx][i];
+        if (row_feature[row] >= 0) {
+          if (conflict_cnt++ == 0) {
+            conflict_fidx = fidx;
+            conflict_other_fidx = row_feature[row];
+          }
+        } else {
+          row_feature[row] = fidx;
+        }
+      }
+    }
+    for (int fidx : features) {
+      for (int i = 0; i < num_per_col[fidx]; ++i) {
+        row_feature[sample_indices[fidx][i]] = -1;
+      }
+    }
+    if (conflict_cnt > max_error_cnt) {
+      Log::Warning("Features %d and %d of feature groups %s are both non-zero in %d sampled rows, will bundle the set as usual",
+                   conflict_other_fidx, conflict_fidx, filename, conflict_cnt);
+      rest_features->insert(rest_features->end(), features.begin(), features.end());
+    } else {
+      exclusive_groups.push_back(features);
+    }
+  }
+  std::sort(rest_features->begin(), rest_features->end());
+  *features_in_group = std::move(exclusive_groups);
+}
+
 void Dataset::Construct(
   std::vector<std::unique_ptr<BinMapper>>& bin_mappers,
   int** sample_non_zero_indices,
@@ -231,15 +339,29 @@ void Dataset::Construct(
                 If the num_row (num_data) is small, you can set min_data=1 and min_data_in_bin=1 to fix this. \
                 Otherwise please make sure you are using the right dataset.");
   }
+  // declared exclusive sets are bundled as they are, the other features as usual
+  std::vector<std::vector<int>> declared_groups;
+  if (!io_config.feature_group_file.empty()) {
+    const int num_used_features = static_cast<int>(used_features.size());
+    declared_groups = LoadFeatureGroups(io_config.feature_group_file.c_str(), bin_mappers,
+                                        io_config.device_type == std::string("gpu"), &used_features);
+    CheckFeatureGroups(io_config.feature_group_file.c_str(), sample_non_zero_indices, num_per_col, total_sample_cnt,
+                       static_cast<data_size_t>(total_sample_cnt * io_config.max_conflict_rate),
+                       &declared_groups, &used_features);
+    Log::Info("Bundled %d features to %d groups from %s, %d features left",
+              num_used_features - static_cast<int>(used_features.size()), static_cast<int>(declared_groups.size()),
+              io_config.feature_group_file.c_str(), static_cast<int>(used_features.size()));
+  }
   auto features_in_group = NoGroup(used_features);
 
-  if (io_config.enable_bundle) {
+  if (io_config.enable_bundle && !used_features.empty()) {
     features_in_group = FastFeatureBundling(bin_mappers,
                                             sample_non_zero_indices, num_per_col, total_sample_cnt,
                                             used_features, io_config.max_conflict_rate,
                                             num_data_, io_config.min_data_in_leaf,
                                             sparse_threshold_, io_config.is_enable_sparse, io_config.device_type == std::string("gpu"));
   }
+  features_in_group.insert(features_in_group.begin(), declared_groups.begin(), declared_groups.end());
 
   num_features_ = 0;
   for (const auto& fs : features_in_group) {
@@ -493,7 +615,7 @@ bool Dataset::GetIntField(const char* field_name, data_size_t* out_len, const in
   return true;
 }
 
-void Dataset::SaveBinaryFile(const char* bin_filename) {
+void Dataset::SaveBinaryFile(const char* bin_filename, bool is_compressed) {
   if (bin_filename != nullptr
       && std::string(bin_filename) == std::string(data_filename_)) {
     Log::Warning("Bianry file %s already existed", bin_filename);
@@ -520,17 +642,24 @@ void Dataset::SaveBinaryFile(const char* bin_filename) {
   }
 
   if (!is_file_existed) {
+    // a compressed file is made from the uncompressed file, written next to it first
+    std::string raw_filename(bin_filename);
+    if (is_compressed) {
+      raw_filename.append(".tmp");
+    }
     #ifdef _MSC_VER
-    fopen_s(&file, bin_filename, "wb");
+    fopen_s(&file, raw_filename.c_str(), "wb");
     #else
-    file = fopen(bin_filename, "wb");
+    file = fopen(raw_filename.c_str(), "wb");
     #endif
     if (file == NULL) {
-      Log::Fatal("Cannot write binary data to %s ", bin_filename);
+      Log::Fatal("Cannot write binary data to %s ", raw_filename.c_str());
     }
     Log::Info("Saving data to binary file %s", bin_filename);
     size_t size_of_token = std::strlen(binary_file_token);
     fwrite(binary_file_token, sizeof(char), size_of_token, file);
+    // position in file, used to align the bin data of feature groups
+    size_t offset = size_of_token;
     // get size of header
     size_t size_of_header = sizeof(num_data_) + sizeof(num_features_) + sizeof(num_total_features_)
       + sizeof(int) * num_total_features_ + sizeof(label_idx_) + sizeof(num_groups_)
@@ -540,6 +669,7 @@ void Dataset::SaveBinaryFile(const char* bin_filename) {
       size_of_header += feature_names_[i].size() + sizeof(int);
     }
     fwrite(&size_of_header, sizeof(size_of_header), 1, file);
+    offset += sizeof(size_of_header) + size_of_header;
     // write header
     fwrite(&num_data_, sizeof(num_data_), 1, file);
     fwrite(&num_features_, sizeof(num_features_), 1, file);
@@ -567,19 +697,75 @@ void Dataset::SaveBinaryFile(const char* bin_filename) {
     fwrite(&size_of_metadata, sizeof(size_of_metadata), 1, file);
     // write meta data
     metadata_.SaveBinaryToFile(file);
+    offset += sizeof(size_of_metadata) + size_of_metadata;
 
     // write feature data
     for (int i = 0; i < num_groups_; ++i) {
       // get size of feature
-      size_t size_of_feature = feature_groups_[i]->SizesInByte();
+      offset += sizeof(size_t);
+      size_t size_of_feature = feature_groups_[i]->SizesInByte(offset);
       fwrite(&size_of_feature, sizeof(size_of_feature), 1, file);
       // write feature
-      feature_groups_[i]->SaveBinaryToFile(file);
+      feature_groups_[i]->SaveBinaryToFile(file, offset);
+      offset += size_of_feature;
     }
     fclose(file);
+    if (is_compressed) {
+      CompressBinaryFile(raw_filename.c_str(), bin_filename);
+      std::remove(raw_filename.c_str());
+    }
   }
 }
 
+void Dataset::CompressBinaryFile(const char* raw_filename, const char* bin_filename) {
+  MappedFile raw_file(raw_filename);
+  if (!raw_file.is_open()) {
+    Log::Fatal("Could not read binary data from %s", raw_filename);
+  }
+  FILE* file;
+  #ifdef _MSC_VER
+  fopen_s(&file, bin_filename, "wb");
+  #else
+  file = fopen(bin_filename, "wb");
+  #endif
+  if (file == NULL) {
+    Log::Fatal("Cannot write binary data to %s ", bin_filename);
+  }
+  const size_t size_of_token = std::strlen(binary_file_token);
+  const char* raw_data = raw_file.data() + size_of_token;
+  const size_t raw_size = raw_file.size() - size_of_token;
+  const size_t block_size = kCompressedBinaryBlockSize;
+  const size_t num_blocks = (raw_size + block_size - 1) / block_size;
+  fwrite(compressed_binary_file_token, sizeof(char), std::strlen(compressed_binary_file_token), file);
+  fwrite(&raw_size, sizeof(raw_size), 1, file);
+  fwrite(&block_size, sizeof(block_size), 1, file);
+  std::vector<size_t> compressed_sizes(num_blocks);
+  // a batch of blocks at a time, so only a few compressed blocks are in memory
+  int num_threads = 1;
+  #pragma omp parallel
+  #pragma omp master
+  {
+    num_threads = omp_get_num_threads();
+  }
+  const size_t batch_size = static_cast<size_t>(num_threads) * 2;
+  std::vector<std::vector<char>> compressed_blocks(batch_size);
+  for (size_t batch_start = 0; batch_start < num_blocks; batch_start += batch_size) {
+    const int cnt = static_cast<int>(std::min(batch_size, num_blocks - batch_start));
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < cnt; ++i) {
+      const size_t block_start = (batch_start + i) * block_size;
+      BlockCompression::Compress(raw_data + block_start, std::min(block_size, raw_size - block_start),
+                                 &compressed_blocks[i]);
+    }
+    for (int i = 0; i < cnt; ++i) {
+      compressed_sizes[batch_start + i] = compressed_blocks[i].size();
+      fwrite(compressed_blocks[i].data(), sizeof(char), compressed_blocks[i].size(), file);
+    }
+  }
+  fwrite(compressed_sizes.data(), sizeof(size_t), num_blocks, file);
+  fclose(file);
+}
+
 void Dataset::ConstructHistograms(const std::vector<int8_t>& is_feature_used,
                                   const data_size_t* data_indices, data_size_t num_data,
                                   int leaf_idx,
@@ -587,7 +773,8 @@ void Dataset::ConstructHistograms(const std::vector<int8_t>& is_feature_used,
                                   const score_t* gradients, const score_t* hessians,
                                   score_t* ordered_gradients, score_t* ordered_hessians,
                                   bool is_constant_hessian,
-                                  HistogramBinEntry* hist_data) const {
+                                  HistogramBinEntry* hist_data,
+                                  bool is_gradients_ordered) const {
 
   if (leaf_idx < 0 || num_data < 0 || hist_data == nullptr) {
     return;
@@ -600,15 +787,16 @@ void Dataset::ConstructHistograms(const std::vector<int8_t>& is_feature_used,
     for (int j = 0; j < f_cnt; ++j) {
       const int fidx = group_feature_start_[group] + j;
       if (is_feature_used[fidx]) {
+        used_group.push_back(group);
         break;
       }
     }
-    used_group.push_back(group);
   }
-  int num_used_group = static_cast<int>(used_group.size());
+  SortGroupsByCost(&used_group);
   auto ptr_ordered_grad = gradients;
   auto ptr_ordered_hess = hessians;
-  if (data_indices != nullptr && num_data < num_data_) {
+  const bool is_ordered = data_indices != nullptr && num_data < num_data_;
+  if (is_ordered && !is_gradients_ordered) {
     if (!is_constant_hessian) {
       #pragma omp parallel for schedule(static)
       for (data_size_t i = 0; i < num_data; ++i) {
@@ -621,11 +809,16 @@ void Dataset::ConstructHistograms(const std::vector<int8_t>& is_feature_used,
         ordered_gradients[i] = gradients[data_indices[i]];
       }
     }
+  }
+  if (is_ordered) {
     ptr_ordered_grad = ordered_gradients;
     ptr_ordered_hess = ordered_hessians;
+  }
+  int num_used_group = static_cast<int>(used_group.size());
+  if (is_ordered) {
     if (!is_constant_hessian) {
       OMP_INIT_EX();
-      #pragma omp parallel for schedule(static)
+      #pragma omp parallel for schedule(dynamic)
       for (int gi = 0; gi < num_used_group; ++gi) {
         OMP_LOOP_EX_BEGIN();
         int group = used_group[gi];
@@ -636,25 +829,28 @@ void Dataset::ConstructHistograms(const std::vector<int8_t>& is_feature_used,
         // construct histograms for smaller leaf
         if (ordered_bins[group] == nullptr) {
           // if not use ordered bin
-          feature_groups_[group]->bin_data_->ConstructHistogram(
-            data_indices,
-            num_data,
-            ptr_ordered_grad,
-            ptr_ordered_hess,
-            data_ptr);
+          ConstructHistogramByHessianBlocks(group, num_data, data_ptr, [&] (data_size_t start, data_size_t cnt, HistogramBinEntry* out) {
+            feature_groups_[group]->bin_data_->ConstructHistogram(
+              data_indices + start,
+              cnt,
+              ptr_ordered_grad + start,
+              ptr_ordered_hess + start,
+              out);
+          });
         } else {
           // used ordered bin
-          ordered_bins[group]->ConstructHistogram(leaf_idx,
-                                                  gradients,
-                                                  hessians,
-                                                  data_ptr);
+          const OrderedBin* ordered_bin = ordered_bins[group].get();
+          ConstructHistogramByHessianBlocks(group, ordered_bin->NonZeroCount(leaf_idx), data_ptr,
+                                            [&] (data_size_t start, data_size_t cnt, HistogramBinEntry* out) {
+            ordered_bin->ConstructHistogram(leaf_idx, start, start + cnt, gradients, hessians, out);
+          });
         }
         OMP_LOOP_EX_END();
       }
       OMP_THROW_EX();
     } else {
       OMP_INIT_EX();
-      #pragma omp parallel for schedule(static)
+      #pragma omp parallel for schedule(dynamic)
       for (int gi = 0; gi < num_used_group; ++gi) {
         OMP_LOOP_EX_BEGIN();
         int group = used_group[gi];
@@ -687,7 +883,7 @@ void Dataset::ConstructHistograms(const std::vector<int8_t>& is_feature_used,
   } else {
     if (!is_constant_hessian) {
       OMP_INIT_EX();
-      #pragma omp parallel for schedule(static)
+      #pragma omp parallel for schedule(dynamic)
       for (int gi = 0; gi < num_used_group; ++gi) {
         OMP_LOOP_EX_BEGIN();
         int group = used_group[gi];
@@ -698,24 +894,32 @@ void Dataset::ConstructHistograms(const std::vector<int8_t>& is_feature_used,
         // construct histograms for smaller leaf
         if (ordered_bins[group] == nullptr) {
           // if not use ordered bin
-          feature_groups_[group]->bin_data_->ConstructHistogram(
-            num_data,
-            ptr_ordered_grad,
-            ptr_ordered_hess,
-            data_ptr);
+          const Bin* bin_data = feature_groups_[group]->bin_data_.get();
+          std::vector<data_size_t> block_indices;
+          ConstructHistogramByHessianBlocks(group, num_data, data_ptr, [&] (data_size_t start, data_size_t cnt, HistogramBinEntry* out) {
+            if (cnt == num_data) {
+              bin_data->ConstructHistogram(num_data, ptr_ordered_grad, ptr_ordered_hess, out);
+            } else {
+              // a block of all data, by the kernel for data indices
+              block_indices.resize(cnt);
+              std::iota(block_indices.begin(), block_indices.end(), start);
+              bin_data->ConstructHistogram(block_indices.data(), cnt, ptr_ordered_grad + start, ptr_ordered_hess + start, out);
+            }
+          });
         } else {
           // used ordered bin
-          ordered_bins[group]->ConstructHistogram(leaf_idx,
-                                                  gradients,
-                                                  hessians,
-                                                  data_ptr);
+          const OrderedBin* ordered_bin = ordered_bins[group].get();
+          ConstructHistogramByHessianBlocks(group, ordered_bin->NonZeroCount(leaf_idx), data_ptr,
+                                            [&] (data_size_t start, data_size_t cnt, HistogramBinEntry* out) {
+            ordered_bin->ConstructHistogram(leaf_idx, start, start + cnt, gradients, hessians, out);
+          });
         }
         OMP_LOOP_EX_END();
       }
       OMP_THROW_EX();
     } else {
       OMP_INIT_EX();
-      #pragma omp parallel for schedule(static)
+      #pragma omp parallel for schedule(dynamic)
       for (int gi = 0; gi < num_used_group; ++gi) {
         OMP_LOOP_EX_BEGIN();
         int group = used_group[gi];
@@ -747,6 +951,345 @@ void Dataset::ConstructHistograms(const std::vector<int8_t>& is_feature_used,
   }
 }
 
+void Dataset::ConstructHistograms(const std::vector<int8_t>& is_feature_used,
+                                  const std::vector<LeafHistogram>& leaves,
+                                  std::vector<std::unique_ptr<OrderedBin>>& ordered_bins,
+                                  const score_t* gradients, const score_t* hessians,
+                                  bool is_constant_hessian) const {
+  std::vector<int> used_group;
+  used_group.reserve(num_groups_);
+  for (int group = 0; group < num_groups_; ++group) {
+    const int f_cnt = group_feature_cnt_[group];
+    for (int j = 0; j < f_cnt; ++j) {
+      const int fidx = group_feature_start_[group] + j;
+      if (is_feature_used[fidx]) {
+        used_group.push_back(group);
+        break;
+      }
+    }
+  }
+  SortGroupsByCost(&used_group);
+  // larger leaves first, so the dynamically scheduled threads don't end with one big leaf left
+  std::vector<int> leaf_order(leaves.size());
+  std::iota(leaf_order.begin(), leaf_order.end(), 0);
+  std::stable_sort(leaf_order.begin(), leaf_order.end(), [&leaves] (int a, int b) {
+    return leaves[a].num_data > leaves[b].num_data;
+  });
+  const int num_used_group = static_cast<int>(used_group.size());
+  const int num_tasks = static_cast<int>(leaves.size()) * num_used_group;
+  OMP_INIT_EX();
+  #pragma omp parallel
+  {
+    for (const LeafHistogram& leaf : leaves) {
+      if (leaf.is_gradients_ordered) { continue; }
+      #pragma omp for schedule(static) nowait
+      for (data_size_t i = 0; i < leaf.num_data; ++i) {
+        leaf.ordered_gradients[i] = gradients[leaf.data_indices[i]];
+        if (!is_constant_hessian) {
+          leaf.ordered_hessians[i] = hessians[leaf.data_indices[i]];
+        }
+      }
+    }
+    #pragma omp barrier
+    #pragma omp for schedule(dynamic)
+    for (int task = 0; task < num_tasks; ++task) {
+      OMP_LOOP_EX_BEGIN();
+      const LeafHistogram& leaf = leaves[leaf_order[task / num_used_group]];
+      const int group = used_group[task % num_used_group];
+      auto data_ptr = leaf.histogram_data + group_bin_boundaries_[group];
+      const int num_bin = feature_groups_[group]->num_total_bin_;
+      std::fill(data_ptr + 1, data_ptr + num_bin, HistogramBinEntry());
+      if (ordered_bins[group] == nullptr) {
+        const Bin* bin_data = feature_groups_[group]->bin_data_.get();
+        if (!is_constant_hessian) {
+          ConstructHistogramByHessianBlocks(group, leaf.num_data, data_ptr, [&] (data_size_t start, data_size_t cnt, HistogramBinEntry* out) {
+            bin_data->ConstructHistogram(leaf.data_indices + start, cnt, leaf.ordered_gradients + start,
+                                         leaf.ordered_hessians + start, out);
+          });
+        } else {
+          bin_data->ConstructHistogram(leaf.data_indices, leaf.num_data, leaf.ordered_gradients, data_ptr);
+        }
+      } else {
+        const OrderedBin* ordered_bin = ordered_bins[group].get();
+        if (!is_constant_hessian) {
+          ConstructHistogramByHessianBlocks(group, ordered_bin->NonZeroCount(leaf.leaf_idx), data_ptr,
+                                            [&] (data_size_t start, data_size_t cnt, HistogramBinEntry* out) {
+            ordered_bin->ConstructHistogram(leaf.leaf_idx, start, start + cnt, gradients, hessians, out);
+          });
+        } else {
+          ordered_bin->ConstructHistogram(leaf.leaf_idx, gradients, data_ptr);
+        }
+      }
+      if (is_constant_hessian) {
+        // fixed hessian.
+        for (int i = 0; i < num_bin; ++i) {
+          data_ptr[i].sum_hessians = data_ptr[i].cnt * hessians[0];
+        }
+      }
+      OMP_LOOP_EX_END();
+    }
+  }
+  OMP_THROW_EX();
+}
+
+void Dataset::ConstructQuantizedHistograms(const std::vector<int8_t>& is_feature_used,
+                                           const data_size_t* data_indices, data_size_t num_data,
+                                           int leaf_idx,
+                                           std::vector<std::unique_ptr<OrderedBin>>& ordered_bins,
+                                           const packed_grad_t* packed_gradients,
+                                           packed_grad_t* ordered_packed_gradients,
+                                           double gradient_scale, double hessian_scale,
+                                           QuantizedHistogramBinEntry* quantized_hist_data,
+                                           HistogramBinEntry* hist_data) const {
+  if (leaf_idx < 0 || num_data < 0 || hist_data == nullptr) {
+    return;
+  }
+  std::vector<int> used_group;
+  used_group.reserve(num_groups_);
+  for (int group = 0; group < num_groups_; ++group) {
+    const int f_cnt = group_feature_cnt_[group];
+    for (int j = 0; j < f_cnt; ++j) {
+      const int fidx = group_feature_start_[group] + j;
+      if (is_feature_used[fidx]) {
+        used_group.push_back(group);
+        break;
+      }
+    }
+  }
+  SortGroupsByCost(&used_group);
+  const bool is_ordered = data_indices != nullptr && num_data < num_data_;
+  if (is_ordered) {
+    #pragma omp parallel for schedule(static)
+    for (data_size_t i = 0; i < num_data; ++i) {
+      ordered_packed_gradients[i] = packed_gradients[data_indices[i]];
+    }
+  }
+  int num_used_group = static_cast<int>(used_group.size());
+  OMP_INIT_EX();
+  #pragma omp parallel for schedule(dynamic)
+  for (int gi = 0; gi < num_used_group; ++gi) {
+    OMP_LOOP_EX_BEGIN();
+    int group = used_group[gi];
+    auto quantized_ptr = quantized_hist_data + group_bin_boundaries_[group];
+    const int num_bin = feature_groups_[group]->num_total_bin_;
+    std::memset(quantized_ptr, 0, num_bin * sizeof(QuantizedHistogramBinEntry));
+    if (ordered_bins[group] != nullptr) {
+      ordered_bins[group]->ConstructHistogram(leaf_idx, packed_gradients, quantized_ptr);
+    } else if (is_ordered) {
+      feature_groups_[group]->bin_data_->ConstructHistogram(data_indices, num_data,
+                                                            ordered_packed_gradients, quantized_ptr);
+    } else {
+      feature_groups_[group]->bin_data_->ConstructHistogram(num_data, packed_gradients, quantized_ptr);
+    }
+    RescaleQuantizedHistogram(group, gradient_scale, hessian_scale, quantized_hist_data, hist_data);
+    OMP_LOOP_EX_END();
+  }
+  OMP_THROW_EX();
+}
+
+void Dataset::SortGroupsByCost(std::vector<int>* groups) const {
+  // a dense group reads every row of the leaf, a sparse group about its non-zero rows, and both clear their bins
+  std::vector<double> cost(num_groups_, 0.0f);
+  for (int group : *groups) {
+    double nnz_rate = 1.0f;
+    if (feature_groups_[group]->is_sparse_) {
+      nnz_rate = 0.0f;
+      for (int j = 0; j < group_feature_cnt_[group]; ++j) {
+        nnz_rate += 1.0f - feature_groups_[group]->bin_mappers_[j]->sparse_rate();
+      }
+      nnz_rate = std::min(nnz_rate, 1.0);
+    }
+    cost[group] = nnz_rate * num_data_ + feature_groups_[group]->num_total_bin_;
+  }
+  std::stable_sort(groups->begin(), groups->end(), [&cost] (int a, int b) {
+    return cost[a] > cost[b];
+  });
+}
+
+void Dataset::RescaleQuantizedHistogram(int group, double gradient_scale, double hessian_scale,
+                                        const QuantizedHistogramBinEntry* quantized_hist_data,
+                                        HistogramBinEntry* hist_data) const {
+  auto quantized_ptr = quantized_hist_data + group_bin_boundaries_[group];
+  auto data_ptr = hist_data + group_bin_boundaries_[group];
+  const int num_bin = feature_groups_[group]->num_total_bin_;
+  // bin zero is not used
+  for (int i = 1; i < num_bin; ++i) {
+    data_ptr[i].sum_gradients = quantized_ptr[i].sum_gradients() * gradient_scale;
+    data_ptr[i].sum_hessians = static_cast<hist_hess_t>(quantized_ptr[i].sum_hessians() * hessian_scale);
+    data_ptr[i].cnt = quantized_ptr[i].cnt;
+  }
+}
+
+template<typename CONSTRUCT_FUN>
+void Dataset::ConstructHistogramByHessianBlocks(int group, data_size_t num_data, HistogramBinEntry* out,
+                                                const CONSTRUCT_FUN& construct_fun) const {
+#ifdef USE_COMPACT_HISTOGRAM
+  if (num_data > kHessianBlockSize) {
+    const int num_bin = feature_groups_[group]->num_total_bin_;
+    std::vector<HistogramBinEntry> block_out(num_bin);
+    std::vector<double> sum_hessians(num_bin, 0.0f);
+    for (data_size_t start = 0; start < num_data; start += kHessianBlockSize) {
+      std::fill(block_out.begin(), block_out.end(), HistogramBinEntry());
+      construct_fun(start, std::min(kHessianBlockSize, num_data - start), block_out.data());
+      // bin zero is not used
+      for (int i = 1; i < num_bin; ++i) {
+        out[i].sum_gradients += block_out[i].sum_gradients;
+        out[i].cnt += block_out[i].cnt;
+        sum_hessians[i] += block_out[i].sum_hessians;
+      }
+    }
+    for (int i = 1; i < num_bin; ++i) {
+      out[i].sum_hessians = static_cast<hist_hess_t>(sum_hessians[i]);
+    }
+    return;
+  }
+#else
+  // only the float hessians need the bins of the group
+  (void)group;
+#endif
+  construct_fun(0, num_data, out);
+}
+
+double Dataset::ExpectedNonZeroGroupsPerRow() const {
+  double nnz = 0.0f;
+  for (int group = 0; group < num_groups_; ++group) {
+    double group_nnz = 0.0f;
+    for (int j = 0; j < group_feature_cnt_[group]; ++j) {
+      group_nnz += 1.0f - FeatureBinMapper(group_feature_start_[group] + j)->sparse_rate();
+    }
+    nnz += std::min(1.0, group_nnz);
+  }
+  return nnz;
+}
+
+void Dataset::CreateRowWiseBins(std::vector<uint64_t>* row_ptr, std::vector<uint32_t>* row_bins) const {
+  int num_threads = 1;
+  #pragma omp parallel
+  #pragma omp master
+  {
+    num_threads = omp_get_num_threads();
+  }
+  const data_size_t block_size = (num_data_ + num_threads - 1) / num_threads;
+  std::vector<std::vector<uint32_t>> block_bins(num_threads);
+  row_ptr->assign(num_data_ + 1, 0);
+  OMP_INIT_EX();
+  #pragma omp parallel for schedule(static, 1)
+  for (int block = 0; block < num_threads; ++block) {
+    OMP_LOOP_EX_BEGIN();
+    const data_size_t start = block * block_size;
+    const data_size_t end = std::min(start + block_size, num_data_);
+    if (start >= end) { continue; }
+    std::vector<std::unique_ptr<BinIterator>> iterators(num_groups_);
+    for (int group = 0; group < num_groups_; ++group) {
+      iterators[group].reset(feature_groups_[group]->FeatureGroupIterator());
+      iterators[group]->Reset(start);
+    }
+    for (data_size_t i = start; i < end; ++i) {
+      const size_t cnt_before = block_bins[block].size();
+      for (int group = 0; group < num_groups_; ++group) {
+        const uint32_t bin = iterators[group]->RawGet(i);
+        // bin zero of a group is not used by histograms
+        if (bin != 0) {
+          block_bins[block].push_back(static_cast<uint32_t>(group_bin_boundaries_[group] + bin));
+        }
+      }
+      (*row_ptr)[i + 1] = block_bins[block].size() - cnt_before;
+    }
+    OMP_LOOP_EX_END();
+  }
+  OMP_THROW_EX();
+  for (data_size_t i = 0; i < num_data_; ++i) {
+    (*row_ptr)[i + 1] += (*row_ptr)[i];
+  }
+  row_bins->resize(row_ptr->back());
+  #pragma omp parallel for schedule(static, 1)
+  for (int block = 0; block < num_threads; ++block) {
+    const data_size_t start = block * block_size;
+    if (start >= num_data_) { continue; }
+    std::copy(block_bins[block].begin(), block_bins[block].end(), row_bins->begin() + (*row_ptr)[start]);
+  }
+}
+
+void Dataset::ConstructRowWiseHistograms(const std::vector<uint64_t>& row_ptr, const std::vector<uint32_t>& row_bins,
+                                         const data_size_t* data_indices, data_size_t num_data,
+                                         const score_t* gradients, const score_t* hessians,
+                                         bool is_constant_hessian, int num_threads,
+                                         std::vector<HistogramBinEntry>* hist_buffer,
+                                         HistogramBinEntry* hist_data) const {
+  if (num_data < 0 || hist_data == nullptr) {
+    return;
+  }
+  const data_size_t min_block_size = 1024;
+  const size_t num_total_bin = static_cast<size_t>(NumTotalBin());
+  const int num_blocks = std::max(1, std::min(num_threads, static_cast<int>(num_data / min_block_size)));
+  const data_size_t block_size = (num_data + num_blocks - 1) / num_blocks;
+  if (hist_buffer->size() < (num_blocks - 1) * num_total_bin) {
+    hist_buffer->resize((num_blocks - 1) * num_total_bin);
+  }
+#ifdef USE_COMPACT_HISTOGRAM
+  // a float hessian sum stops growing once it is large, the blocks sum their hessians in double
+  std::vector<double> block_hessians(num_blocks * num_total_bin, 0.0f);
+#endif
+  OMP_INIT_EX();
+  #pragma omp parallel for schedule(static, 1)
+  for (int block = 0; block < num_blocks; ++block) {
+    OMP_LOOP_EX_BEGIN();
+    HistogramBinEntry* out = block == 0 ? hist_data : hist_buffer->data() + (block - 1) * num_total_bin;
+    std::fill(out, out + num_total_bin, HistogramBinEntry());
+    const data_size_t start = block * block_size;
+    const data_size_t end = std::min(start + block_size, num_data);
+#ifdef USE_COMPACT_HISTOGRAM
+    double* hessian_out = block_hessians.data() + block * num_total_bin;
+#endif
+    for (data_size_t i = start; i < end; ++i) {
+      const data_size_t idx = data_indices == nullptr ? i : data_indices[i];
+      const score_t gradient = gradients[idx];
+      const score_t hessian = is_constant_hessian ? 0.0f : hessians[idx];
+      for (uint64_t j = row_ptr[idx]; j < row_ptr[idx + 1]; ++j) {
+        HistogramBinEntry& entry = out[row_bins[j]];
+        entry.sum_gradients += gradient;
+#ifdef USE_COMPACT_HISTOGRAM
+        hessian_out[row_bins[j]] += hessian;
+#else
+        entry.sum_hessians += hessian;
+#endif
+        ++entry.cnt;
+      }
+    }
+    OMP_LOOP_EX_END();
+  }
+  OMP_THROW_EX();
+  // sum the private histograms of the blocks
+  const int bin_block_size = 4096;
+  const int num_bin_blocks = static_cast<int>((num_total_bin + bin_block_size - 1) / bin_block_size);
+  #pragma omp parallel for schedule(static)
+  for (int bin_block = 0; bin_block < num_bin_blocks; ++bin_block) {
+    const size_t start = static_cast<size_t>(bin_block) * bin_block_size;
+    const size_t end = std::min(start + bin_block_size, num_total_bin);
+    for (int block = 1; block < num_blocks; ++block) {
+      const HistogramBinEntry* block_out = hist_buffer->data() + (block - 1) * num_total_bin;
+      HistogramBinEntry::SumReducer(reinterpret_cast<const char*>(block_out + start),
+                                    reinterpret_cast<char*>(hist_data + start),
+                                    static_cast<int>((end - start) * sizeof(HistogramBinEntry)));
+    }
+#ifdef USE_COMPACT_HISTOGRAM
+    for (size_t i = start; i < end; ++i) {
+      double sum_hessian = 0.0f;
+      for (int block = 0; block < num_blocks; ++block) {
+        sum_hessian += block_hessians[block * num_total_bin + i];
+      }
+      hist_data[i].sum_hessians = static_cast<hist_hess_t>(sum_hessian);
+    }
+#endif
+    if (is_constant_hessian) {
+      // fixed hessian.
+      for (size_t i = start; i < end; ++i) {
+        hist_data[i].sum_hessians = hist_data[i].cnt * hessians[0];
+      }
+    }
+  }
+}
+
 void Dataset::FixHistogram(int feature_idx, double sum_gradient, double sum_hessian, data_size_t num_data,
                            HistogramBinEntry* data) const {
   const int group = feature2group_[feature_idx];
@@ -756,15 +1299,17 @@ void Dataset::FixHistogram(int feature_idx, double sum_gradient, double sum_hess
   if (default_bin > 0) {
     const int num_bin = bin_mapper->num_bin();
     data[default_bin].sum_gradients = sum_gradient;
-    data[default_bin].sum_hessians = sum_hessian;
     data[default_bin].cnt = num_data;
+    // subtract in double, the hessians of the histogram may be stored as float
+    double default_bin_hessian = sum_hessian;
     for (int i = 0; i < num_bin; ++i) {
       if (i != default_bin) {
         data[default_bin].sum_gradients -= data[i].sum_gradients;
-        data[default_bin].sum_hessians -= data[i].sum_hessians;
+        default_bin_hessian -= data[i].sum_hessians;
         data[default_bin].cnt -= data[i].cnt;
       }
     }
+    data[default_bin].sum_hessians = static_cast<hist_hess_t>(default_bin_hessian);
   }
 }
 
@@ -1,12 +1,159 @@
 #include <LightGBM/utils/openmp_wrapper.h>
 
 #include <LightGBM/utils/log.h>
+#include <LightGBM/utils/block_compression.h>
 #include <LightGBM/dataset_loader.h>
 #include <LightGBM/network.h>
+#include <LightGBM/window_feature.h>
 
+#include <cstdio>
+#include <cstdlib>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 namespace LightGBM {
 
+namespace {
+
+/*!
+* \brief Append a parsed row to the spool: label, number of features, whether all values are 1,
+*        feature indices and, if not all 1, feature values
+*/
+void AppendSpoolRow(double label, const std::vector<std::pair<int, double>>& features, std::vector<char>* out) {
+  const float label_f = static_cast<float>(label);
+  const int32_t num_features = static_cast<int32_t>(features.size());
+  char is_indicator = 1;
+  for (auto& inner_data : features) {
+    if (inner_data.second != 1.0) {
+      is_indicator = 0;
+      break;
+    }
+  }
+  size_t pos = out->size();
+  out->resize(pos + sizeof(label_f) + sizeof(num_features) + sizeof(is_indicator)
+              + num_features * (sizeof(int32_t) + (is_indicator ? 0 : sizeof(double))));
+  char* p = out->data() + pos;
+  std::memcpy(p, &label_f, sizeof(label_f));
+  p += sizeof(label_f);
+  std::memcpy(p, &num_features, sizeof(num_features));
+  p += sizeof(num_features);
+  *p = is_indicator;
+  p += sizeof(is_indicator);
+  for (auto& inner_data : features) {
+    const int32_t idx = inner_data.first;
+    std::memcpy(p, &idx, sizeof(idx));
+    p += sizeof(idx);
+  }
+  if (!is_indicator) {
+    for (auto& inner_data : features) {
+      std::memcpy(p, &inner_data.second, sizeof(double));
+      p += sizeof(double);
+    }
+  }
+}
+
+/*! \brief Size of the spool row starting at p */
+size_t SpoolRowSize(const char* p) {
+  int32_t num_features;
+  std::memcpy(&num_features, p + sizeof(float), sizeof(num_features));
+  const char is_indicator = p[sizeof(float) + sizeof(num_features)];
+  return sizeof(float) + sizeof(num_features) + sizeof(is_indicator)
+    + num_features * (sizeof(int32_t) + (is_indicator ? 0 : sizeof(double)));
+}
+
+/*! \brief Read the spool row starting at p */
+void ReadSpoolRow(const char* p, double* label, std::vector<std::pair<int, double>>* features) {
+  float label_f;
+  std::memcpy(&label_f, p, sizeof(label_f));
+  *label = label_f;
+  p += sizeof(label_f);
+  int32_t num_features;
+  std::memcpy(&num_features, p, sizeof(num_features));
+  p += sizeof(num_features);
+  const char is_indicator = *p;
+  p += sizeof(is_indicator);
+  const char* values = p + num_features * sizeof(int32_t);
+  for (int32_t i = 0; i < num_features; ++i) {
+    int32_t idx;
+    std::memcpy(&idx, p + i * sizeof(int32_t), sizeof(idx));
+    double val = 1.0;
+    if (!is_indicator) {
+      std::memcpy(&val, values + i * sizeof(double), sizeof(val));
+    }
+    features->emplace_back(idx, val);
+  }
+}
+
+/*!
+* \brief Temporary spool file with a unique name in dir, or in the system temporary directory if dir is empty.
+*        The file is removed when this is destroyed. On POSIX its name is removed right after creating it,
+*        so the file also goes away if the process crashes
+*/
+class SpoolFile {
+public:
+  explicit SpoolFile(const std::string& dir) {
+#ifndef _WIN32
+    std::string tmp_dir = dir;
+    if (tmp_dir.empty()) {
+      const char* env_dir = std::getenv("TMPDIR");
+      tmp_dir = (env_dir != nullptr && env_dir[0] != '\0') ? env_dir : "/tmp";
+    }
+    std::string name = tmp_dir + "/lightgbm_spool_XXXXXX";
+    const int fd = mkstemp(&name[0]);
+    if (fd < 0) {
+      Log::Fatal("Could not create spool file in %s", tmp_dir.c_str());
+    }
+    unlink(name.c_str());
+    file_ = fdopen(fd, "w+b");
+    if (file_ == NULL) {
+      close(fd);
+      Log::Fatal("Could not open spool file in %s", tmp_dir.c_str());
+    }
+#else
+    char* name = _tempnam(dir.empty() ? NULL : dir.c_str(), "lightgbm_spool_");
+    if (name == NULL) {
+      Log::Fatal("Could not create spool file in %s", dir.c_str());
+    }
+    name_ = name;
+    free(name);
+#ifdef _MSC_VER
+    fopen_s(&file_, name_.c_str(), "w+b");
+#else
+    file_ = fopen(name_.c_str(), "w+b");
+#endif
+    if (file_ == NULL) {
+      Log::Fatal("Could not open spool file %s for writing", name_.c_str());
+    }
+#endif
+  }
+
+  ~SpoolFile() {
+    if (file_ != NULL) {
+      fclose(file_);
+    }
+    if (!name_.empty()) {
+      std::remove(name_.c_str());
+    }
+  }
+
+  /*! \brief The open file, for writing and reading */
+  FILE* file() const { return file_; }
+
+  /*! \brief Disable copy */
+  SpoolFile& operator=(const SpoolFile&) = delete;
+  /*! \brief Disable copy */
+  SpoolFile(const SpoolFile&) = delete;
+
+private:
+  FILE* file_ = NULL;
+  /*! \brief Name to remove at the end, empty if the file has no name anymore */
+  std::string name_;
+};
+
+}  // namespace
+
 DatasetLoader::DatasetLoader(const IOConfig& io_config, const PredictFunction& predict_fun, int num_class, const char* filename)
   :io_config_(io_config), random_(io_config_.data_random_seed), predict_fun_(predict_fun), num_class_(num_class) {
   label_idx_ = 0;
@@ -176,9 +323,28 @@ Dataset* DatasetLoader::LoadFromFile(const char* filename, const char* initscore
     dataset->data_filename_ = filename;
     dataset->label_idx_ = label_idx_;
     dataset->metadata_.Init(filename, initscore_file);
-    if (!io_config_.use_two_round_loading) {
+    if (io_config_.use_streaming_loading) {
+      // parse data once, spool the rows to a temporary file and sample them at the same time
+      SpoolFile spool_file(io_config_.spool_dir);
+      auto sample_data = SpoolTextDataToFile(filename, spool_file.file(), parser.get(), dataset->metadata_, rank, num_machines,
+                                             static_cast<data_size_t>(io_config_.bin_construct_sample_cnt),
+                                             &num_global_data, &used_data_indices);
+      if (used_data_indices.size() > 0) {
+        dataset->num_data_ = static_cast<data_size_t>(used_data_indices.size());
+      } else {
+        dataset->num_data_ = num_global_data;
+      }
+      // construct feature bin mappers
+      ConstructBinMappersFromTextData(rank, num_machines, sample_data, parser.get(), dataset.get());
+      // initialize label
+      dataset->metadata_.Init(dataset->num_data_, weight_idx_, group_idx_);
+      // extract features
+      ExtractFeaturesFromSpool(spool_file.file(), dataset.get());
+    } else if (!io_config_.use_two_round_loading) {
       // read data to memory
-      auto text_data = LoadTextDataToMemory(filename, dataset->metadata_, rank, num_machines, &num_global_data, &used_data_indices);
+      MappedTextReader<data_size_t> text_reader(filename, io_config_.has_header);
+      LoadTextDataToMemory(&text_reader, dataset->metadata_, rank, num_machines, &num_global_data, &used_data_indices);
+      const auto& text_data = text_reader.Lines();
       dataset->num_data_ = static_cast<data_size_t>(text_data.size());
       // sample data
       auto sample_data = SampleTextDataFromMemory(text_data);
@@ -188,7 +354,7 @@ Dataset* DatasetLoader::LoadFromFile(const char* filename, const char* initscore
       dataset->metadata_.Init(dataset->num_data_, weight_idx_, group_idx_);
       // extract features
       ExtractFeaturesFromMemory(text_data, parser.get(), dataset.get());
-      text_data.clear();
+      text_reader.Clear();
     } else {
       // sample data from file
       auto sample_data = SampleTextDataFromFile(filename, dataset->metadata_, rank, num_machines, &num_global_data, &used_data_indices);
@@ -231,16 +397,29 @@ Dataset* DatasetLoader::LoadFromFileAlignWithOtherDataset(const char* filename,
     dataset->data_filename_ = filename;
     dataset->label_idx_ = label_idx_;
     dataset->metadata_.Init(filename, initscore_file);
-    if (!io_config_.use_two_round_loading) {
+    if (io_config_.use_streaming_loading) {
+      // parse data once and spool the rows to a temporary file
+      SpoolFile spool_file(io_config_.spool_dir);
+      SpoolTextDataToFile(filename, spool_file.file(), parser.get(), dataset->metadata_, 0, 1, 0,
+                          &num_global_data, &used_data_indices);
+      dataset->num_data_ = num_global_data;
+      // initialize label
+      dataset->metadata_.Init(dataset->num_data_, weight_idx_, group_idx_);
+      dataset->CreateValid(train_data);
+      // extract features
+      ExtractFeaturesFromSpool(spool_file.file(), dataset.get());
+    } else if (!io_config_.use_two_round_loading) {
       // read data in memory
-      auto text_data = LoadTextDataToMemory(filename, dataset->metadata_, 0, 1, &num_global_data, &used_data_indices);
+      MappedTextReader<data_size_t> text_reader(filename, io_config_.has_header);
+      LoadTextDataToMemory(&text_reader, dataset->metadata_, 0, 1, &num_global_data, &used_data_indices);
+      const auto& text_data = text_reader.Lines();
       dataset->num_data_ = static_cast<data_size_t>(text_data.size());
       // initialize label
       dataset->metadata_.Init(dataset->num_data_, weight_idx_, group_idx_);
       dataset->CreateValid(train_data);
       // extract features
       ExtractFeaturesFromMemory(text_data, parser.get(), dataset.get());
-      text_data.clear();
+      text_reader.Clear();
     } else {
       TextReader<data_size_t> text_reader(filename, io_config_.has_header);
       // Get number of lines of data file
@@ -264,53 +443,43 @@ Dataset* DatasetLoader::LoadFromFileAlignWithOtherDataset(const char* filename,
 
 Dataset* DatasetLoader::LoadFromBinFile(const char* data_filename, const char* bin_filename, int rank, int num_machines, int* num_global_data, std::vector<data_size_t>* used_data_indices) {
   auto dataset = std::unique_ptr<Dataset>(new Dataset());
-  FILE* file;
-  #ifdef _MSC_VER
-  fopen_s(&file, bin_filename, "rb");
-  #else
-  file = fopen(bin_filename, "rb");
-  #endif
   dataset->data_filename_ = data_filename;
-  if (file == NULL) {
+  // the bin data of feature groups is used in place from the mapping, pages are read on first access
+  dataset->bin_file_.reset(new MappedFile(bin_filename));
+  if (!dataset->bin_file_->is_open()) {
     Log::Fatal("Could not read binary data from %s", bin_filename);
   }
-
-  // buffer to read binary file
-  size_t buffer_size = 16 * 1024 * 1024;
-  auto buffer = std::vector<char>(buffer_size);
+  const char* file_ptr = dataset->bin_file_->data();
+  const char* file_end = file_ptr + dataset->bin_file_->size();
 
   // check token
   size_t size_of_token = std::strlen(Dataset::binary_file_token);
-  size_t read_cnt = fread(buffer.data(), sizeof(char), size_of_token, file);
-  if (read_cnt != size_of_token) {
+  if (static_cast<size_t>(file_end - file_ptr) < size_of_token) {
     Log::Fatal("Binary file error: token has the wrong size");
   }
-  if (std::string(buffer.data()) != std::string(Dataset::binary_file_token)) {
+  // a compressed file is decompressed into memory, and the bin data is used in place from there
+  if (std::string(file_ptr, size_of_token) == std::string(Dataset::compressed_binary_file_token)) {
+    dataset->bin_file_.reset(DecompressBinaryFile(*dataset->bin_file_, bin_filename));
+    file_ptr = dataset->bin_file_->data();
+    file_end = file_ptr + dataset->bin_file_->size();
+  }
+  if (std::string(file_ptr, size_of_token) != std::string(Dataset::binary_file_token)) {
     Log::Fatal("input file is not LightGBM binary file");
   }
+  file_ptr += size_of_token;
 
   // read size of header
-  read_cnt = fread(buffer.data(), sizeof(size_t), 1, file);
-
-  if (read_cnt != 1) {
+  if (static_cast<size_t>(file_end - file_ptr) < sizeof(size_t)) {
     Log::Fatal("Binary file error: header has the wrong size");
   }
-
-  size_t size_of_head = *(reinterpret_cast<size_t*>(buffer.data()));
-
-  // re-allocmate space if not enough
-  if (size_of_head > buffer_size) {
-    buffer_size = size_of_head;
-    buffer.resize(buffer_size);
-  }
-  // read header
-  read_cnt = fread(buffer.data(), 1, size_of_head, file);
-
-  if (read_cnt != size_of_head) {
+  size_t size_of_head = *(reinterpret_cast<const size_t*>(file_ptr));
+  file_ptr += sizeof(size_of_head);
+  if (static_cast<size_t>(file_end - file_ptr) < size_of_head) {
     Log::Fatal("Binary file error: header is incorrect");
   }
   // get header
-  const char* mem_ptr = buffer.data();
+  const char* mem_ptr = file_ptr;
+  file_ptr += size_of_head;
   dataset->num_data_ = *(reinterpret_cast<const data_size_t*>(mem_ptr));
   mem_ptr += sizeof(dataset->num_data_);
   dataset->num_features_ = *(reinterpret_cast<const int*>(mem_ptr));
@@ -389,27 +558,17 @@ Dataset* DatasetLoader::LoadFromBinFile(const char* data_filename, const char* b
   }
 
   // read size of meta data
-  read_cnt = fread(buffer.data(), sizeof(size_t), 1, file);
-
-  if (read_cnt != 1) {
+  if (static_cast<size_t>(file_end - file_ptr) < sizeof(size_t)) {
     Log::Fatal("Binary file error: meta data has the wrong size");
   }
-
-  size_t size_of_metadata = *(reinterpret_cast<size_t*>(buffer.data()));
-
-  // re-allocate space if not enough
-  if (size_of_metadata > buffer_size) {
-    buffer_size = size_of_metadata;
-    buffer.resize(buffer_size);
-  }
-  //  read meta data
-  read_cnt = fread(buffer.data(), 1, size_of_metadata, file);
-
-  if (read_cnt != size_of_metadata) {
+  size_t size_of_metadata = *(reinterpret_cast<const size_t*>(file_ptr));
+  file_ptr += sizeof(size_of_metadata);
+  if (static_cast<size_t>(file_end - file_ptr) < size_of_metadata) {
     Log::Fatal("Binary file error: meta data is incorrect");
   }
   // load meta data
-  dataset->metadata_.LoadFromMemory(buffer.data());
+  dataset->metadata_.LoadFromMemory(file_ptr);
+  file_ptr += size_of_metadata;
 
   *num_global_data = dataset->num_data_;
   used_data_indices->clear();
@@ -451,30 +610,27 @@ Dataset* DatasetLoader::LoadFromBinFile(const char* data_filename, const char* b
   // read feature data
   for (int i = 0; i < dataset->num_groups_; ++i) {
     // read feature size
-    read_cnt = fread(buffer.data(), sizeof(size_t), 1, file);
-    if (read_cnt != 1) {
+    if (static_cast<size_t>(file_end - file_ptr) < sizeof(size_t)) {
       Log::Fatal("Binary file error: feature %d has the wrong size", i);
     }
-    size_t size_of_feature = *(reinterpret_cast<size_t*>(buffer.data()));
-    // re-allocate space if not enough
-    if (size_of_feature > buffer_size) {
-      buffer_size = size_of_feature;
-      buffer.resize(buffer_size);
-    }
-
-    read_cnt = fread(buffer.data(), 1, size_of_feature, file);
-
-    if (read_cnt != size_of_feature) {
-      Log::Fatal("Binary file error: feature %d is incorrect, read count: %d", i, read_cnt);
+    size_t size_of_feature = *(reinterpret_cast<const size_t*>(file_ptr));
+    file_ptr += sizeof(size_of_feature);
+    if (static_cast<size_t>(file_end - file_ptr) < size_of_feature) {
+      Log::Fatal("Binary file error: feature %d is incorrect, read count: %d", i, static_cast<int>(file_end - file_ptr));
     }
     dataset->feature_groups_.emplace_back(std::unique_ptr<FeatureGroup>(
-      new FeatureGroup(buffer.data(),
+      new FeatureGroup(file_ptr,
                        *num_global_data,
-                       *used_data_indices)
+                       *used_data_indices,
+                       true)
       ));
+    file_ptr += size_of_feature;
   }
   dataset->feature_groups_.shrink_to_fit();
-  fclose(file);
+  // partitioned data is copied out of the file
+  if (!used_data_indices->empty()) {
+    dataset->bin_file_.reset(nullptr);
+  }
   dataset->is_finish_load_ = true;
   return dataset.release();
 }
@@ -601,6 +757,169 @@ Dataset* DatasetLoader::CostructFromSampleData(double** sample_values,
   return dataset.release();
 }
 
+data_size_t DatasetLoader::BuildCorpusIndex(const char* filename, const char* index_filename,
+                                            WindowFeatureIndex* out_index) {
+  WindowFeatureCounter counter;
+  const data_size_t num_data = CountCorpusKeys(filename, &counter);
+  counter.BuildIndex(io_config_.min_feature_count, out_index);
+  out_index->SaveToFile(index_filename);
+  const std::string stats_filename = std::string(index_filename) + ".stats";
+  counter.SaveStatsToFile(stats_filename.c_str(), *out_index);
+  const std::string groups_filename = std::string(index_filename) + ".groups";
+  out_index->SaveGroupsToFile(groups_filename.c_str());
+  Log::Info("Saved feature index with %d of %d keys (min_feature_count=%d) to %s, counts to %s, groups to %s",
+            out_index->size(), counter.size(), io_config_.min_feature_count, index_filename, stats_filename.c_str(),
+            groups_filename.c_str());
+  return num_data;
+}
+
+data_size_t DatasetLoader::CountCorpusKeys(const char* filename, WindowFeatureCounter* out_counter) {
+  int num_threads = 1;
+  #pragma omp parallel
+  #pragma omp master
+  {
+    num_threads = omp_get_num_threads();
+  }
+  WindowFeatureCounter& counter = *out_counter;
+  counter = WindowFeatureCounter(num_threads);
+  MappedTextReader<data_size_t> text_reader(filename, io_config_.has_header);
+  const data_size_t num_data = text_reader.ReadAllAndProcessParallel(
+    [&counter] (data_size_t start_idx, const std::vector<TextLine>& lines) {
+    std::string buffer;
+    std::vector<uint32_t> codepoints;
+    OMP_INIT_EX();
+    #pragma omp parallel for schedule(static) private(buffer, codepoints)
+    for (data_size_t i = 0; i < static_cast<data_size_t>(lines.size()); ++i) {
+      OMP_LOOP_EX_BEGIN();
+      const int tid = omp_get_thread_num();
+      WindowFeature::ParseLine(lines[i].data, lines[i].size, &buffer, &codepoints);
+      for (size_t j = 0; j < codepoints.size(); ++j) {
+        counter.Add(tid, WindowFeature::Key(static_cast<int>(j), codepoints[j]), start_idx + i);
+      }
+      OMP_LOOP_EX_END();
+    }
+    OMP_THROW_EX();
+  });
+  counter.Merge();
+  return num_data;
+}
+
+Dataset* DatasetLoader::LoadFromCorpus(const char* filename, const char* index_filename) {
+  WindowFeatureIndex index;
+  data_size_t num_data = 0;
+  int num_col = 0;
+  const int num_hash_bits = io_config_.feature_hash_bits;
+  const bool is_hash_signed = io_config_.is_feature_hash_signed;
+  if (num_hash_bits <= 0 && !index.LoadFromFile(index_filename)) {
+    num_data = BuildCorpusIndex(filename, index_filename, &index);
+  } else {
+    if (num_hash_bits <= 0) {
+      Log::Info("Loaded feature index %s with %d keys", index_filename, index.size());
+    }
+    // the ids are known without reading the corpus, only count its lines
+    MappedTextReader<data_size_t> text_reader(filename, io_config_.has_header);
+    num_data = text_reader.ReadAllAndProcessParallel([] (data_size_t, const std::vector<TextLine>&) {});
+  }
+  num_col = num_hash_bits > 0 ? (1 << num_hash_bits) : index.size();
+  if (num_data <= 0) {
+    Log::Fatal("Data file %s is empty", filename);
+  }
+  if (num_col <= 0) {
+    Log::Fatal("No usable features in data file %s", filename);
+  }
+  // ids of the characters of a line, keys without id are dropped
+  auto parse_line = [&index, num_hash_bits, is_hash_signed]
+    (const TextLine& line, std::string* buffer, std::vector<uint32_t>* codepoints,
+     std::vector<std::pair<int, double>>* out_features) {
+    const double label = WindowFeature::ParseLine(line.data, line.size, buffer, codepoints);
+    out_features->clear();
+    if (num_hash_bits > 0) {
+      WindowFeature::HashFeatures(*codepoints, num_hash_bits, is_hash_signed, out_features);
+      return label;
+    }
+    for (size_t j = 0; j < codepoints->size(); ++j) {
+      const int id = index.Get(WindowFeature::Key(static_cast<int>(j), (*codepoints)[j]));
+      if (id >= 0) {
+        out_features->emplace_back(id, 1.0f);
+      }
+    }
+    return label;
+  };
+  // sample the same lines as the text loaders for the bin mappers
+  int sample_cnt = io_config_.bin_construct_sample_cnt;
+  if (sample_cnt > num_data) {
+    sample_cnt = num_data;
+  }
+  auto sample_data_indices = random_.Sample(num_data, sample_cnt);
+  std::vector<std::vector<double>> sample_values(num_col);
+  std::vector<std::vector<int>> sample_indices(num_col);
+  {
+    MappedTextReader<data_size_t> text_reader(filename, io_config_.has_header);
+    std::string buffer;
+    std::vector<uint32_t> codepoints;
+    std::vector<std::pair<int, double>> oneline_features;
+    // with hashed ids, the keys of the sampled lines are counted for the collision stats
+    WindowFeatureCounter sample_counter(1);
+    text_reader.ReadPartAndProcessParallel(sample_data_indices,
+      [&parse_line, &buffer, &codepoints, &oneline_features, &sample_values, &sample_indices,
+       &sample_counter, num_hash_bits]
+      (data_size_t start_idx, const std::vector<TextLine>& lines) {
+      for (size_t i = 0; i < lines.size(); ++i) {
+        parse_line(lines[i], &buffer, &codepoints, &oneline_features);
+        for (auto& inner_data : oneline_features) {
+          sample_values[inner_data.first].emplace_back(inner_data.second);
+          sample_indices[inner_data.first].emplace_back(start_idx + static_cast<int>(i));
+        }
+        if (num_hash_bits > 0) {
+          for (size_t j = 0; j < codepoints.size(); ++j) {
+            sample_counter.Add(0, WindowFeature::Key(static_cast<int>(j), codepoints[j]), start_idx + static_cast<int>(i));
+          }
+        }
+      }
+    });
+    if (num_hash_bits > 0) {
+      sample_counter.Merge();
+      sample_counter.LogHashCollisions(num_hash_bits, sample_cnt);
+    }
+  }
+  std::vector<int> num_per_col(num_col);
+  for (int i = 0; i < num_col; ++i) {
+    num_per_col[i] = static_cast<int>(sample_values[i].size());
+  }
+  auto dataset = std::unique_ptr<Dataset>(
+    CostructFromSampleData(Common::Vector2Ptr<double>(sample_values).data(),
+                           Common::Vector2Ptr<int>(sample_indices).data(),
+                           num_col, num_per_col.data(), sample_data_indices.size(), num_data));
+  sample_values.clear();
+  sample_indices.clear();
+  dataset->data_filename_ = filename;
+  // push the rows straight into the bins, block by block
+  {
+    MappedTextReader<data_size_t> text_reader(filename, io_config_.has_header);
+    text_reader.ReadAllAndProcessParallel(
+      [&parse_line, &dataset] (data_size_t start_idx, const std::vector<TextLine>& lines) {
+      std::string buffer;
+      std::vector<uint32_t> codepoints;
+      std::vector<std::pair<int, double>> oneline_features;
+      OMP_INIT_EX();
+      #pragma omp parallel for schedule(static) private(buffer, codepoints, oneline_features)
+      for (data_size_t i = 0; i < static_cast<data_size_t>(lines.size()); ++i) {
+        OMP_LOOP_EX_BEGIN();
+        const int tid = omp_get_thread_num();
+        const double label = parse_line(lines[i], &buffer, &codepoints, &oneline_features);
+        dataset->metadata_.SetLabelAt(start_idx + i, static_cast<float>(label));
+        dataset->PushOneRow(tid, start_idx + i, oneline_features);
+        OMP_LOOP_EX_END();
+      }
+      OMP_THROW_EX();
+    });
+  }
+  dataset->FinishLoad();
+  CheckDataset(dataset.get());
+  Log::Info("Built dataset of %d rows and %d features from corpus %s", num_data, num_col, filename);
+  return dataset.release();
+}
+
 
 // ---- private functions ----
 
@@ -638,21 +957,20 @@ void DatasetLoader::CheckDataset(const Dataset* dataset) {
   }
 }
 
-std::vector<std::string> DatasetLoader::LoadTextDataToMemory(const char* filename, const Metadata& metadata,
-                                                             int rank, int num_machines, int* num_global_data,
-                                                             std::vector<data_size_t>* used_data_indices) {
-  TextReader<data_size_t> text_reader(filename, io_config_.has_header);
+void DatasetLoader::LoadTextDataToMemory(MappedTextReader<data_size_t>* text_reader, const Metadata& metadata,
+                                         int rank, int num_machines, int* num_global_data,
+                                         std::vector<data_size_t>* used_data_indices) {
   used_data_indices->clear();
   if (num_machines == 1 || io_config_.is_pre_partition) {
     // read all lines
-    *num_global_data = text_reader.ReadAllLines();
+    *num_global_data = text_reader->ReadAllLines();
   } else {  // need partition data
             // get query data
     const data_size_t* query_boundaries = metadata.query_boundaries();
 
     if (query_boundaries == nullptr) {
       // if not contain query data, minimal sample unit is one record
-      *num_global_data = text_reader.ReadAndFilterLines([this, rank, num_machines](data_size_t) {
+      *num_global_data = text_reader->ReadAndFilterLines([this, rank, num_machines](data_size_t) {
         if (random_.NextShort(0, num_machines) == rank) {
           return true;
         } else {
@@ -664,7 +982,7 @@ std::vector<std::string> DatasetLoader::LoadTextDataToMemory(const char* filenam
       data_size_t num_queries = metadata.num_queries();
       data_size_t qid = -1;
       bool is_query_used = false;
-      *num_global_data = text_reader.ReadAndFilterLines(
+      *num_global_data = text_reader->ReadAndFilterLines(
         [this, rank, num_machines, &qid, &query_boundaries, &is_query_used, num_queries]
       (data_size_t line_idx) {
         if (qid >= num_queries) {
@@ -682,10 +1000,9 @@ std::vector<std::string> DatasetLoader::LoadTextDataToMemory(const char* filenam
       }, used_data_indices);
     }
   }
-  return std::move(text_reader.Lines());
 }
 
-std::vector<std::string> DatasetLoader::SampleTextDataFromMemory(const std::vector<std::string>& data) {
+std::vector<std::string> DatasetLoader::SampleTextDataFromMemory(const std::vector<TextLine>& data) {
   int sample_cnt = io_config_.bin_construct_sample_cnt;
   if (static_cast<size_t>(sample_cnt) > data.size()) {
     sample_cnt = static_cast<int>(data.size());
@@ -694,7 +1011,7 @@ std::vector<std::string> DatasetLoader::SampleTextDataFromMemory(const std::vect
   std::vector<std::string> out(sample_indices.size());
   for (size_t i = 0; i < sample_indices.size(); ++i) {
     const size_t idx = sample_indices[i];
-    out[i] = data[idx];
+    out[i] = std::string(data[idx].data, data[idx].size);
   }
   return out;
 }
@@ -745,6 +1062,97 @@ std::vector<std::string> DatasetLoader::SampleTextDataFromFile(const char* filen
   return out_data;
 }
 
+std::vector<std::string> DatasetLoader::SpoolTextDataToFile(const char* filename, FILE* spool_file, const Parser* parser,
+                                                           const Metadata& metadata, int rank, int num_machines, data_size_t sample_cnt,
+                                                           int* num_global_data, std::vector<data_size_t>* used_data_indices) {
+  std::vector<std::string> out_data;
+  used_data_indices->clear();
+  const bool need_partition = num_machines > 1 && !io_config_.is_pre_partition;
+  const data_size_t* query_boundaries = metadata.query_boundaries();
+  const data_size_t num_queries = metadata.num_queries();
+  data_size_t qid = -1;
+  bool is_query_used = false;
+  std::function<bool(data_size_t, data_size_t)> filter_fun =
+    [this, need_partition, rank, num_machines, query_boundaries, num_queries, &qid, &is_query_used, &used_data_indices]
+  (data_size_t, data_size_t line_idx) {
+    if (!need_partition) {
+      return true;
+    }
+    if (query_boundaries == nullptr) {
+      // if not contain query data, minimal sample unit is one record
+      if (random_.NextShort(0, num_machines) != rank) {
+        return false;
+      }
+    } else {
+      // if contain query data, minimal sample unit is one query
+      if (qid >= num_queries) {
+        Log::Fatal("Current query exceeds the range of the query file, please ensure the query file is correct");
+      }
+      if (line_idx >= query_boundaries[qid + 1]) {
+        // if is new query
+        is_query_used = (random_.NextShort(0, num_machines) == rank);
+        ++qid;
+      }
+      if (!is_query_used) {
+        return false;
+      }
+    }
+    used_data_indices->push_back(line_idx);
+    return true;
+  };
+  int num_threads = 1;
+  #pragma omp parallel
+  #pragma omp master
+  {
+    num_threads = omp_get_num_threads();
+  }
+  std::vector<std::vector<char>> thread_buffers(num_threads);
+  std::function<void(data_size_t, const std::vector<TextLine>&)> process_fun =
+    [this, parser, sample_cnt, num_threads, &out_data, &thread_buffers, &spool_file]
+  (data_size_t start_idx, const std::vector<TextLine>& lines) {
+    const data_size_t num_lines = static_cast<data_size_t>(lines.size());
+    // reservoir sampling, the same as TextReader::SampleFromFile
+    for (data_size_t i = 0; i < num_lines; ++i) {
+      const data_size_t line_idx = start_idx + i;
+      if (line_idx < sample_cnt) {
+        out_data.emplace_back(lines[i].data, lines[i].size);
+      } else {
+        const data_size_t idx = static_cast<data_size_t>(random_.NextInt(0, line_idx + 1));
+        if (idx < sample_cnt) {
+          out_data[idx] = std::string(lines[i].data, lines[i].size);
+        }
+      }
+    }
+    // every thread parses a contiguous range of lines, so the buffers are written in line order
+    const data_size_t step = (num_lines + num_threads - 1) / num_threads;
+    OMP_INIT_EX();
+    #pragma omp parallel for schedule(static, 1)
+    for (int tid = 0; tid < num_threads; ++tid) {
+      OMP_LOOP_EX_BEGIN();
+      std::vector<std::pair<int, double>> oneline_features;
+      double tmp_label = 0.0f;
+      thread_buffers[tid].clear();
+      const data_size_t end = std::min(num_lines, step * (tid + 1));
+      for (data_size_t i = step * tid; i < end; ++i) {
+        oneline_features.clear();
+        parser->ParseOneLine(lines[i].data, &oneline_features, &tmp_label);
+        AppendSpoolRow(tmp_label, oneline_features, &thread_buffers[tid]);
+      }
+      OMP_LOOP_EX_END();
+    }
+    OMP_THROW_EX();
+    for (int tid = 0; tid < num_threads; ++tid) {
+      if (!thread_buffers[tid].empty()
+          && fwrite(thread_buffers[tid].data(), 1, thread_buffers[tid].size(), spool_file) != thread_buffers[tid].size()) {
+        Log::Fatal("Could not write spool file");
+      }
+    }
+  };
+  MappedTextReader<data_size_t> text_reader(filename, io_config_.has_header);
+  *num_global_data = text_reader.ReadAllAndProcessParallelWithFilter(process_fun, filter_fun);
+  return out_data;
+}
+
 void DatasetLoader::ConstructBinMappersFromTextData(int rank, int num_machines, const std::vector<std::string>& sample_data, const Parser* parser, Dataset* dataset) {
 
   std::vector<std::vector<double>> sample_values;
@@ -903,7 +1311,7 @@ void DatasetLoader::ConstructBinMappersFromTextData(int rank, int num_machines,
 }
 
 /*! \brief Extract local features from memory */
-void DatasetLoader::ExtractFeaturesFromMemory(std::vector<std::string>& text_data, const Parser* parser, Dataset* dataset) {
+void DatasetLoader::ExtractFeaturesFromMemory(const std::vector<TextLine>& text_data, const Parser* parser, Dataset* dataset) {
   std::vector<std::pair<int, double>> oneline_features;
   double tmp_label = 0.0f;
   if (predict_fun_ == nullptr) {
@@ -915,13 +1323,9 @@ void DatasetLoader::ExtractFeaturesFromMemory(std::vector<std::string>& text_dat
       const int tid = omp_get_thread_num();
       oneline_features.clear();
       // parser
-      parser->ParseOneLine(text_data[i].c_str(), &oneline_features, &tmp_label);
+      parser->ParseOneLine(text_data[i].data, &oneline_features, &tmp_label);
       // set label
       dataset->metadata_.SetLabelAt(i, static_cast<float>(tmp_label));
-      // free processed line:
-      text_data[i].clear();
-      // shrink_to_fit will be very slow in linux, and seems not free memory, disable for now
-      // text_reader_->Lines()[i].shrink_to_fit();
       // push data
       for (auto& inner_data : oneline_features) {
         if (inner_data.first >= dataset->num_total_features_) { continue; }
@@ -952,7 +1356,7 @@ void DatasetLoader::ExtractFeaturesFromMemory(std::vector<std::string>& text_dat
       const int tid = omp_get_thread_num();
       oneline_features.clear();
       // parser
-      parser->ParseOneLine(text_data[i].c_str(), &oneline_features, &tmp_label);
+      parser->ParseOneLine(text_data[i].data, &oneline_features, &tmp_label);
       // set initial score
       std::vector<double> oneline_init_score(num_class_);
       predict_fun_(oneline_features, oneline_init_score.data());
@@ -961,10 +1365,6 @@ void DatasetLoader::ExtractFeaturesFromMemory(std::vector<std::string>& text_dat
       }
       // set label
       dataset->metadata_.SetLabelAt(i, static_cast<float>(tmp_label));
-      // free processed line:
-      text_data[i].clear();
-      // shrink_to_fit will be very slow in linux, and seems not free memory, disable for now
-      // text_reader_->Lines()[i].shrink_to_fit();
       // push data
       for (auto& inner_data : oneline_features) {
         if (inner_data.first >= dataset->num_total_features_) { continue; }
@@ -989,8 +1389,6 @@ void DatasetLoader::ExtractFeaturesFromMemory(std::vector<std::string>& text_dat
     dataset->metadata_.SetInitScore(init_score.data(), dataset->num_data_ * num_class_);
   }
   dataset->FinishLoad();
-  // text data can be free after loaded feature values
-  text_data.clear();
 }
 
 /*! \brief Extract local features from file */
@@ -999,9 +1397,9 @@ void DatasetLoader::ExtractFeaturesFromFile(const char* filename, const Parser*
   if (predict_fun_ != nullptr) {
     init_score = std::vector<double>(dataset->num_data_ * num_class_);
   }
-  std::function<void(data_size_t, const std::vector<std::string>&)> process_fun =
+  std::function<void(data_size_t, const std::vector<TextLine>&)> process_fun =
     [this, &init_score, &parser, &dataset]
-  (data_size_t start_idx, const std::vector<std::string>& lines) {
+  (data_size_t start_idx, const std::vector<TextLine>& lines) {
     std::vector<std::pair<int, double>> oneline_features;
     double tmp_label = 0.0f;
     OMP_INIT_EX();
@@ -1011,7 +1409,7 @@ void DatasetLoader::ExtractFeaturesFromFile(const char* filename, const Parser*
       const int tid = omp_get_thread_num();
       oneline_features.clear();
       // parser
-      parser->ParseOneLine(lines[i].c_str(), &oneline_features, &tmp_label);
+      parser->ParseOneLine(lines[i].data, &oneline_features, &tmp_label);
       // set initial score
       if (!init_score.empty()) {
         std::vector<double> oneline_init_score(num_class_);
@@ -1043,7 +1441,7 @@ void DatasetLoader::ExtractFeaturesFromFile(const char* filename, const Parser*
     }
     OMP_THROW_EX();
   };
-  TextReader<data_size_t> text_reader(filename, io_config_.has_header);
+  MappedTextReader<data_size_t> text_reader(filename, io_config_.has_header);
   if (!used_data_indices.empty()) {
     // only need part of data
     text_reader.ReadPartAndProcessParallel(used_data_indices, process_fun);
@@ -1059,6 +1457,135 @@ void DatasetLoader::ExtractFeaturesFromFile(const char* filename, const Parser*
   dataset->FinishLoad();
 }
 
+/*! \brief Extract local features from the spool file */
+void DatasetLoader::ExtractFeaturesFromSpool(FILE* spool_file, Dataset* dataset) {
+  std::vector<double> init_score;
+  if (predict_fun_ != nullptr) {
+    init_score = std::vector<double>(dataset->num_data_ * num_class_);
+  }
+  data_size_t num_read = 0;
+  {
+    MappedFile spool(spool_file);
+    if (!spool.is_open()) {
+      Log::Fatal("Could not map spool file");
+    }
+    const char* buffer = spool.data();
+    const size_t size = spool.size();
+    const size_t block_size = 16 * 1024 * 1024;
+    std::vector<size_t> row_starts;
+    size_t pos = 0;
+    while (pos < size) {
+      // rows have different sizes, find the starts of the rows in this block first
+      const size_t block_start = pos;
+      row_starts.clear();
+      while (pos < size && pos - block_start < block_size) {
+        row_starts.push_back(pos);
+        pos += SpoolRowSize(buffer + pos);
+      }
+      const data_size_t start_idx = num_read;
+      std::vector<std::pair<int, double>> oneline_features;
+      double tmp_label = 0.0f;
+      OMP_INIT_EX();
+      #pragma omp parallel for schedule(static) private(oneline_features) firstprivate(tmp_label)
+      for (data_size_t i = 0; i < static_cast<data_size_t>(row_starts.size()); ++i) {
+        OMP_LOOP_EX_BEGIN();
+        const int tid = omp_get_thread_num();
+        oneline_features.clear();
+        ReadSpoolRow(buffer + row_starts[i], &tmp_label, &oneline_features);
+        // set initial score
+        if (!init_score.empty()) {
+          std::vector<double> oneline_init_score(num_class_);
+          predict_fun_(oneline_features, oneline_init_score.data());
+          for (int k = 0; k < num_class_; ++k) {
+            init_score[k * dataset->num_data_ + start_idx + i] = static_cast<double>(oneline_init_score[k]);
+          }
+        }
+        // set label
+        dataset->metadata_.SetLabelAt(start_idx + i, static_cast<float>(tmp_label));
+        // push data
+        for (auto& inner_data : oneline_features) {
+          if (inner_data.first >= dataset->num_total_features_) { continue; }
+          int feature_idx = dataset->used_feature_map_[inner_data.first];
+          if (feature_idx >= 0) {
+            // if is used feature
+            int group = dataset->feature2group_[feature_idx];
+            int sub_feature = dataset->feature2subfeature_[feature_idx];
+            dataset->feature_groups_[group]->PushData(tid, sub_feature, start_idx + i, inner_data.second);
+          } else {
+            if (inner_data.first == weight_idx_) {
+              dataset->metadata_.SetWeightAt(start_idx + i, static_cast<float>(inner_data.second));
+            } else if (inner_data.first == group_idx_) {
+              dataset->metadata_.SetQueryAt(start_idx + i, static_cast<data_size_t>(inner_data.second));
+            }
+          }
+        }
+        OMP_LOOP_EX_END();
+      }
+      OMP_THROW_EX();
+      num_read += static_cast<data_size_t>(row_starts.size());
+      spool.Release(block_start, pos - block_start);
+    }
+  }
+  if (num_read != dataset->num_data_) {
+    Log::Fatal("Spool file has %d rows, expected %d", num_read, dataset->num_data_);
+  }
+  // metadata_ will manage space of init_score
+  if (!init_score.empty()) {
+    dataset->metadata_.SetInitScore(init_score.data(), dataset->num_data_ * num_class_);
+  }
+  dataset->FinishLoad();
+}
+
+MappedFile* DatasetLoader::DecompressBinaryFile(const MappedFile& file, const char* bin_filename) {
+  const size_t size_of_token = std::strlen(Dataset::compressed_binary_file_token);
+  const char* file_ptr = file.data() + size_of_token;
+  const size_t size = file.size() - size_of_token;
+  if (size < 2 * sizeof(size_t)) {
+    Log::Fatal("Binary file error: compressed file %s is truncated", bin_filename);
+  }
+  // the header follows the token, so it is not aligned
+  size_t raw_size = 0;
+  size_t block_size = 0;
+  std::memcpy(&raw_size, file_ptr, sizeof(size_t));
+  std::memcpy(&block_size, file_ptr + sizeof(size_t), sizeof(size_t));
+  if (block_size == 0) {
+    Log::Fatal("Binary file error: compressed file %s is corrupted", bin_filename);
+  }
+  const size_t num_blocks = (raw_size + block_size - 1) / block_size;
+  if (size < (2 + num_blocks) * sizeof(size_t)) {
+    Log::Fatal("Binary file error: compressed file %s is truncated", bin_filename);
+  }
+  // compressed sizes are at the end of the file
+  std::vector<size_t> block_starts(num_blocks + 1, 2 * sizeof(size_t));
+  const char* sizes_ptr = file_ptr + size - num_blocks * sizeof(size_t);
+  for (size_t i = 0; i < num_blocks; ++i) {
+    size_t compressed_size = 0;
+    std::memcpy(&compressed_size, sizes_ptr + i * sizeof(size_t), sizeof(size_t));
+    block_starts[i + 1] = block_starts[i] + compressed_size;
+  }
+  if (block_starts[num_blocks] != size - num_blocks * sizeof(size_t)) {
+    Log::Fatal("Binary file error: compressed file %s is corrupted", bin_filename);
+  }
+  // the uncompressed file starts with its token, so the alignment of the bin data is kept
+  const size_t size_of_raw_token = std::strlen(Dataset::binary_file_token);
+  std::vector<char> content(size_of_raw_token + raw_size);
+  std::memcpy(content.data(), Dataset::binary_file_token, size_of_raw_token);
+  char* raw_data = content.data() + size_of_raw_token;
+  bool is_corrupted = false;
+  #pragma omp parallel for schedule(dynamic) reduction(||:is_corrupted)
+  for (int i = 0; i < static_cast<int>(num_blocks); ++i) {
+    const size_t raw_start = i * block_size;
+    if (!BlockCompression::Decompress(file_ptr + block_starts[i], block_starts[i + 1] - block_starts[i],
+                                      raw_data + raw_start, std::min(block_size, raw_size - raw_start))) {
+      is_corrupted = true;
+    }
+  }
+  if (is_corrupted) {
+    Log::Fatal("Binary file error: compressed file %s is corrupted", bin_filename);
+  }
+  return new MappedFile(std::move(content));
+}
+
 /*! \brief Check can load from binary file */
 std::string DatasetLoader::CheckCanLoadFromBin(const char* filename) {
   std::string bin_filename(filename);
@@ -1091,9 +1618,18 @@ std::string DatasetLoader::CheckCanLoadFromBin(const char* filename) {
   size_t read_cnt = fread(buffer.data(), sizeof(char), size_of_token, file);
   fclose(file);
   if (read_cnt == size_of_token
-      && std::string(buffer.data()) == std::string(Dataset::binary_file_token)) {
+      && (std::string(buffer.data()) == std::string(Dataset::binary_file_token)
+          || std::string(buffer.data()) == std::string(Dataset::compressed_binary_file_token))) {
     return bin_filename;
   } else {
+    // binary files before the bin data was aligned for memory mapping
+    const char* old_binary_file_token = "______LightGBM_Binary_File_Token______\n";
+    if (std::string(buffer.data(), std::strlen(old_binary_file_token)) == std::string(old_binary_file_token)) {
+      if (bin_filename == std::string(filename)) {
+        Log::Fatal("Binary file %s has an old format, please save it again from text data", filename);
+      }
+      Log::Warning("Binary file %s has an old format and is ignored, please save it again", bin_filename.c_str());
+    }
     return std::string();
   }
 
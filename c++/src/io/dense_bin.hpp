@@ -2,6 +2,7 @@
 #define LIGHTGBM_IO_DENSE_BIN_HPP_
 
 #include <LightGBM/bin.h>
+#include <LightGBM/utils/mappable_vector.h>
 
 #include <vector>
 #include <cstring>
@@ -69,6 +70,7 @@ public:
     const data_size_t rest = num_data & 0x3;
     data_size_t i = 0;
     for (; i < num_data - rest; i += 4) {
+      PREFETCH_AHEAD4(i, num_data, j, data_.data() + data_indices[j]);
       const VAL_T bin0 = data_[data_indices[i]];
       const VAL_T bin1 = data_[data_indices[i + 1]];
       const VAL_T bin2 = data_[data_indices[i + 2]];
@@ -137,6 +139,7 @@ public:
     const data_size_t rest = num_data & 0x3;
     data_size_t i = 0;
     for (; i < num_data - rest; i += 4) {
+      PREFETCH_AHEAD4(i, num_data, j, data_.data() + data_indices[j]);
       const VAL_T bin0 = data_[data_indices[i]];
       const VAL_T bin1 = data_[data_indices[i + 1]];
       const VAL_T bin2 = data_[data_indices[i + 2]];
@@ -187,6 +190,63 @@ public:
     }
   }
 
+  void ConstructHistogram(const data_size_t* data_indices, data_size_t num_data,
+                          const packed_grad_t* ordered_packed_gradients,
+                          QuantizedHistogramBinEntry* out) const override {
+    const data_size_t rest = num_data & 0x3;
+    data_size_t i = 0;
+    for (; i < num_data - rest; i += 4) {
+      PREFETCH_AHEAD4(i, num_data, j, data_.data() + data_indices[j]);
+      const VAL_T bin0 = data_[data_indices[i]];
+      const VAL_T bin1 = data_[data_indices[i + 1]];
+      const VAL_T bin2 = data_[data_indices[i + 2]];
+      const VAL_T bin3 = data_[data_indices[i + 3]];
+
+      out[bin0].sum_gradients_hessians += ordered_packed_gradients[i];
+      out[bin1].sum_gradients_hessians += ordered_packed_gradients[i + 1];
+      out[bin2].sum_gradients_hessians += ordered_packed_gradients[i + 2];
+      out[bin3].sum_gradients_hessians += ordered_packed_gradients[i + 3];
+
+      ++out[bin0].cnt;
+      ++out[bin1].cnt;
+      ++out[bin2].cnt;
+      ++out[bin3].cnt;
+    }
+    for (; i < num_data; ++i) {
+      const VAL_T bin = data_[data_indices[i]];
+      out[bin].sum_gradients_hessians += ordered_packed_gradients[i];
+      ++out[bin].cnt;
+    }
+  }
+
+  void ConstructHistogram(data_size_t num_data,
+                          const packed_grad_t* ordered_packed_gradients,
+                          QuantizedHistogramBinEntry* out) const override {
+    const data_size_t rest = num_data & 0x3;
+    data_size_t i = 0;
+    for (; i < num_data - rest; i += 4) {
+      const VAL_T bin0 = data_[i];
+      const VAL_T bin1 = data_[i + 1];
+      const VAL_T bin2 = data_[i + 2];
+      const VAL_T bin3 = data_[i + 3];
+
+      out[bin0].sum_gradients_hessians += ordered_packed_gradients[i];
+      out[bin1].sum_gradients_hessians += ordered_packed_gradients[i + 1];
+      out[bin2].sum_gradients_hessians += ordered_packed_gradients[i + 2];
+      out[bin3].sum_gradients_hessians += ordered_packed_gradients[i + 3];
+
+      ++out[bin0].cnt;
+      ++out[bin1].cnt;
+      ++out[bin2].cnt;
+      ++out[bin3].cnt;
+    }
+    for (; i < num_data; ++i) {
+      const VAL_T bin = data_[i];
+      out[bin].sum_gradients_hessians += ordered_packed_gradients[i];
+      ++out[bin].cnt;
+    }
+  }
+
   virtual data_size_t Split(
     uint32_t min_bin, uint32_t max_bin, uint32_t default_bin, MissingType missing_type, bool default_left,
     uint32_t threshold, data_size_t* data_indices, data_size_t num_data,
@@ -302,6 +362,14 @@ public:
     }
   }
 
+  bool MapFromMemory(const void* memory) override {
+    if (reinterpret_cast<uintptr_t>(memory) % sizeof(VAL_T) != 0) {
+      return false;
+    }
+    data_.Map(reinterpret_cast<const VAL_T*>(memory), num_data_);
+    return true;
+  }
+
   void SaveBinaryToFile(FILE* file) const override {
     fwrite(data_.data(), sizeof(VAL_T), num_data_, file);
   }
@@ -312,7 +380,7 @@ public:
 
 protected:
   data_size_t num_data_;
-  std::vector<VAL_T> data_;
+  MappableVector<VAL_T> data_;
 };
 
 template <typename VAL_T>
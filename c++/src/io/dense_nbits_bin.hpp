@@ -2,6 +2,7 @@
 #define LIGHTGBM_IO_DENSE_NBITS_BIN_HPP_
 
 #include <LightGBM/bin.h>
+#include <LightGBM/utils/mappable_vector.h>
 
 #include <vector>
 #include <cstring>
@@ -40,7 +41,7 @@ public:
   Dense4bitsBin(data_size_t num_data)
     : num_data_(num_data) {
     int len = (num_data_ + 1) / 2;
-    data_ = std::vector<uint8_t>(len, static_cast<uint8_t>(0));
+    data_ = MappableVector<uint8_t>(len, static_cast<uint8_t>(0));
   }
 
   ~Dense4bitsBin() {
@@ -84,6 +85,7 @@ public:
     const data_size_t rest = num_data & 0x3;
     data_size_t i = 0;
     for (; i < num_data - rest; i += 4) {
+      PREFETCH_AHEAD4(i, num_data, j, data_.data() + (data_indices[j] >> 1));
 
       data_size_t idx = data_indices[i];
       const auto bin0 = (data_[idx >> 1] >> ((idx & 1) << 2)) & 0xf;
@@ -165,6 +167,7 @@ public:
     const data_size_t rest = num_data & 0x3;
     data_size_t i = 0;
     for (; i < num_data - rest; i += 4) {
+      PREFETCH_AHEAD4(i, num_data, j, data_.data() + (data_indices[j] >> 1));
       data_size_t idx = data_indices[i];
       const auto bin0 = (data_[idx >> 1] >> ((idx & 1) << 2)) & 0xf;
 
@@ -226,6 +229,74 @@ public:
     }
   }
 
+  void ConstructHistogram(const data_size_t* data_indices, data_size_t num_data,
+                          const packed_grad_t* ordered_packed_gradients,
+                          QuantizedHistogramBinEntry* out) const override {
+    const data_size_t rest = num_data & 0x3;
+    data_size_t i = 0;
+    for (; i < num_data - rest; i += 4) {
+      PREFETCH_AHEAD4(i, num_data, j, data_.data() + (data_indices[j] >> 1));
+      data_size_t idx = data_indices[i];
+      const auto bin0 = (data_[idx >> 1] >> ((idx & 1) << 2)) & 0xf;
+
+      idx = data_indices[i + 1];
+      const auto bin1 = (data_[idx >> 1] >> ((idx & 1) << 2)) & 0xf;
+
+      idx = data_indices[i + 2];
+      const auto bin2 = (data_[idx >> 1] >> ((idx & 1) << 2)) & 0xf;
+
+      idx = data_indices[i + 3];
+      const auto bin3 = (data_[idx >> 1] >> ((idx & 1) << 2)) & 0xf;
+
+      out[bin0].sum_gradients_hessians += ordered_packed_gradients[i];
+      out[bin1].sum_gradients_hessians += ordered_packed_gradients[i + 1];
+      out[bin2].sum_gradients_hessians += ordered_packed_gradients[i + 2];
+      out[bin3].sum_gradients_hessians += ordered_packed_gradients[i + 3];
+
+      ++out[bin0].cnt;
+      ++out[bin1].cnt;
+      ++out[bin2].cnt;
+      ++out[bin3].cnt;
+    }
+
+    for (; i < num_data; ++i) {
+      const data_size_t idx = data_indices[i];
+      const auto bin = (data_[idx >> 1] >> ((idx & 1) << 2)) & 0xf;
+      out[bin].sum_gradients_hessians += ordered_packed_gradients[i];
+      ++out[bin].cnt;
+    }
+  }
+
+  void ConstructHistogram(data_size_t num_data,
+                          const packed_grad_t* ordered_packed_gradients,
+                          QuantizedHistogramBinEntry* out) const override {
+    const data_size_t rest = num_data & 0x3;
+    data_size_t i = 0;
+    for (; i < num_data - rest; i += 4) {
+      int j = i >> 1;
+      const auto bin0 = (data_[j]) & 0xf;
+      const auto bin1 = (data_[j] >> 4) & 0xf;
+      ++j;
+      const auto bin2 = (data_[j]) & 0xf;
+      const auto bin3 = (data_[j] >> 4) & 0xf;
+
+      out[bin0].sum_gradients_hessians += ordered_packed_gradients[i];
+      out[bin1].sum_gradients_hessians += ordered_packed_gradients[i + 1];
+      out[bin2].sum_gradients_hessians += ordered_packed_gradients[i + 2];
+      out[bin3].sum_gradients_hessians += ordered_packed_gradients[i + 3];
+
+      ++out[bin0].cnt;
+      ++out[bin1].cnt;
+      ++out[bin2].cnt;
+      ++out[bin3].cnt;
+    }
+    for (; i < num_data; ++i) {
+      const auto bin = (data_[i >> 1] >> ((i & 1) << 2)) & 0xf;
+      out[bin].sum_gradients_hessians += ordered_packed_gradients[i];
+      ++out[bin].cnt;
+    }
+  }
+
   virtual data_size_t Split(
     uint32_t min_bin, uint32_t max_bin, uint32_t default_bin, MissingType missing_type, bool default_left,
     uint32_t threshold, data_size_t* data_indices, data_size_t num_data,
@@ -370,6 +441,11 @@ public:
     }
   }
 
+  bool MapFromMemory(const void* memory) override {
+    data_.Map(reinterpret_cast<const uint8_t*>(memory), data_.size());
+    return true;
+  }
+
   void SaveBinaryToFile(FILE* file) const override {
     fwrite(data_.data(), sizeof(uint8_t), data_.size(), file);
   }
@@ -380,7 +456,7 @@ public:
 
 protected:
   data_size_t num_data_;
-  std::vector<uint8_t> data_;
+  MappableVector<uint8_t> data_;
   std::vector<uint8_t> buf_;
 };
 
@@ -80,13 +80,21 @@ public:
 
   void ConstructHistogram(int leaf, const score_t* gradient, const score_t* hessian,
                           HistogramBinEntry* out) const override {
-    // get current leaf boundary
-    const data_size_t start = leaf_start_[leaf];
-    const data_size_t end = start + leaf_cnt_[leaf];
+    ConstructHistogram(leaf, 0, leaf_cnt_[leaf], gradient, hessian, out);
+  }
+
+  void ConstructHistogram(int leaf, data_size_t part_start, data_size_t part_end,
+                          const score_t* gradient, const score_t* hessian,
+                          HistogramBinEntry* out) const override {
+    // get current part boundary
+    const data_size_t start = leaf_start_[leaf] + part_start;
+    const data_size_t end = leaf_start_[leaf] + part_end;
     const int rest = (end - start) % 4;
     data_size_t i = start;
     // use data on current leaf to construct histogram
     for (; i < end - rest; i += 4) {
+      PREFETCH_AHEAD4(i, end, j, gradient + ordered_pair_[j].ridx);
+      PREFETCH_AHEAD4(i, end, j, hessian + ordered_pair_[j].ridx);
 
       const VAL_T bin0 = ordered_pair_[i].bin;
       const VAL_T bin1 = ordered_pair_[i + 1].bin;
@@ -141,6 +149,7 @@ public:
     data_size_t i = start;
     // use data on current leaf to construct histogram
     for (; i < end - rest; i += 4) {
+      PREFETCH_AHEAD4(i, end, j, gradient + ordered_pair_[j].ridx);
 
       const VAL_T bin0 = ordered_pair_[i].bin;
       const VAL_T bin1 = ordered_pair_[i + 1].bin;
@@ -170,6 +179,40 @@ public:
     }
   }
 
+  void ConstructHistogram(int leaf, const packed_grad_t* packed_gradients,
+                          QuantizedHistogramBinEntry* out) const override {
+    // get current leaf boundary
+    const data_size_t start = leaf_start_[leaf];
+    const data_size_t end = start + leaf_cnt_[leaf];
+    const int rest = (end - start) % 4;
+    data_size_t i = start;
+    // use data on current leaf to construct histogram
+    for (; i < end - rest; i += 4) {
+      PREFETCH_AHEAD4(i, end, j, packed_gradients + ordered_pair_[j].ridx);
+
+      const VAL_T bin0 = ordered_pair_[i].bin;
+      const VAL_T bin1 = ordered_pair_[i + 1].bin;
+      const VAL_T bin2 = ordered_pair_[i + 2].bin;
+      const VAL_T bin3 = ordered_pair_[i + 3].bin;
+
+      out[bin0].sum_gradients_hessians += packed_gradients[ordered_pair_[i].ridx];
+      out[bin1].sum_gradients_hessians += packed_gradients[ordered_pair_[i + 1].ridx];
+      out[bin2].sum_gradients_hessians += packed_gradients[ordered_pair_[i + 2].ridx];
+      out[bin3].sum_gradients_hessians += packed_gradients[ordered_pair_[i + 3].ridx];
+
+      ++out[bin0].cnt;
+      ++out[bin1].cnt;
+      ++out[bin2].cnt;
+      ++out[bin3].cnt;
+    }
+
+    for (; i < end; ++i) {
+      const VAL_T bin0 = ordered_pair_[i].bin;
+      out[bin0].sum_gradients_hessians += packed_gradients[ordered_pair_[i].ridx];
+      ++out[bin0].cnt;
+    }
+  }
+
   void Split(int leaf, int right_leaf, const char* is_in_leaf, char mark) override {
     // get current leaf boundary
     const data_size_t l_start = leaf_start_[leaf];
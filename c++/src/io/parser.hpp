@@ -87,16 +87,16 @@ public:
     int idx = 0;
     double val = 0.0f;
     if (label_idx_ == 0) {
-      str = Common::Atof(str, &val);
+      str = ParseValue(str, &val);
       *out_label = val;
       str = Common::SkipSpaceAndTab(str);
     }
     while (*str != '\0') {
-      str = Common::Atoi(str, &idx);
+      str = ParseIndex(str, &idx);
       str = Common::SkipSpaceAndTab(str);
       if (*str == ':') {
         ++str;
-        str = Common::Atof(str, &val);
+        str = ParseValue(str, &val);
         out_features->emplace_back(idx, val);
       } else {
         Log::Fatal("Input format error when parsing as LibSVM");
@@ -105,6 +105,39 @@ public:
     }
   }
 private:
+  inline static bool IsTokenEnd(char c) {
+    return c == ' ' || c == '\t' || c == '\0';
+  }
+  /*! \brief Plain digits are converted inline, anything else goes to Common::Atoi */
+  inline static const char* ParseIndex(const char* str, int* out) {
+    if (*str < '0' || *str > '9') {
+      return Common::Atoi(str, out);
+    }
+    int value = *str - '0';
+    ++str;
+    while (*str >= '0' && *str <= '9') {
+      value = value * 10 + (*str - '0');
+      ++str;
+    }
+    *out = value;
+    return str;
+  }
+  /*! \brief Indicator values like 1, 1. or 1.0 are common in sparse data, skip Common::Atof for them */
+  inline static const char* ParseValue(const char* str, double* out) {
+    if (*str == '1') {
+      const char* p = str + 1;
+      if (*p == '.') {
+        ++p;
+        while (*p == '0') { ++p; }
+      }
+      if (IsTokenEnd(*p)) {
+        *out = 1.0;
+        return p;
+      }
+    }
+    return Common::Atof(str, out);
+  }
+
   int label_idx_ = 0;
 };
 
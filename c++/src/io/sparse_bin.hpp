@@ -6,6 +6,7 @@
 #include <LightGBM/bin.h>
 
 #include <LightGBM/utils/openmp_wrapper.h>
+#include <LightGBM/utils/mappable_vector.h>
 
 #include <cstring>
 #include <cstdint>
@@ -122,6 +123,18 @@ public:
     Log::Fatal("Using OrderedSparseBin->ConstructHistogram() instead");
   }
 
+  void ConstructHistogram(const data_size_t*, data_size_t, const packed_grad_t*,
+                          QuantizedHistogramBinEntry*) const override {
+    // Will use OrderedSparseBin->ConstructHistogram() instead
+    Log::Fatal("Using OrderedSparseBin->ConstructHistogram() instead");
+  }
+
+  void ConstructHistogram(data_size_t, const packed_grad_t*,
+                          QuantizedHistogramBinEntry*) const override {
+    // Will use OrderedSparseBin->ConstructHistogram() instead
+    Log::Fatal("Using OrderedSparseBin->ConstructHistogram() instead");
+  }
+
   inline bool NextNonzero(data_size_t* i_delta,
                           data_size_t* cur_pos) const {
     ++(*i_delta);
@@ -318,10 +331,11 @@ public:
     fast_index_.shrink_to_fit();
   }
 
+  /*! \brief vals_ are written before deltas_, so they stay aligned after num_vals_ */
   void SaveBinaryToFile(FILE* file) const override {
     fwrite(&num_vals_, sizeof(num_vals_), 1, file);
-    fwrite(deltas_.data(), sizeof(uint8_t), num_vals_ + 1, file);
     fwrite(vals_.data(), sizeof(VAL_T), num_vals_, file);
+    fwrite(deltas_.data(), sizeof(uint8_t), num_vals_ + 1, file);
   }
 
   size_t SizesInByte() const override {
@@ -329,13 +343,27 @@ public:
       + sizeof(VAL_T) * num_vals_;
   }
 
+  bool MapFromMemory(const void* memory) override {
+    if (reinterpret_cast<uintptr_t>(memory) % sizeof(num_vals_) != 0) {
+      return false;
+    }
+    const char* mem_ptr = reinterpret_cast<const char*>(memory);
+    num_vals_ = *(reinterpret_cast<const data_size_t*>(mem_ptr));
+    mem_ptr += sizeof(num_vals_);
+    vals_.Map(reinterpret_cast<const VAL_T*>(mem_ptr), num_vals_);
+    mem_ptr += sizeof(VAL_T) * num_vals_;
+    deltas_.Map(reinterpret_cast<const uint8_t*>(mem_ptr), num_vals_ + 1);
+    GetFastIndex();
+    return true;
+  }
+
   void LoadFromMemory(const void* memory, const std::vector<data_size_t>& local_used_indices) override {
     const char* mem_ptr = reinterpret_cast<const char*>(memory);
     data_size_t tmp_num_vals = *(reinterpret_cast<const data_size_t*>(mem_ptr));
     mem_ptr += sizeof(tmp_num_vals);
-    const uint8_t* tmp_delta = reinterpret_cast<const uint8_t*>(mem_ptr);
-    mem_ptr += sizeof(uint8_t) * (tmp_num_vals + 1);
     const VAL_T* tmp_vals = reinterpret_cast<const VAL_T*>(mem_ptr);
+    mem_ptr += sizeof(VAL_T) * tmp_num_vals;
+    const uint8_t* tmp_delta = reinterpret_cast<const uint8_t*>(mem_ptr);
 
     deltas_.clear();
     vals_.clear();
@@ -409,8 +437,8 @@ public:
 
 protected:
   data_size_t num_data_;
-  std::vector<uint8_t> deltas_;
-  std::vector<VAL_T> vals_;
+  MappableVector<uint8_t> deltas_;
+  MappableVector<VAL_T> vals_;
   data_size_t num_vals_;
   std::vector<std::vector<std::pair<data_size_t, VAL_T>>> push_buffers_;
   std::vector<std::pair<data_size_t, data_size_t>> fast_index_;
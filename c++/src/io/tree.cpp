@@ -12,6 +12,9 @@
 #include <string>
 #include <memory>
 #include <iomanip>
+#include <algorithm>
+#include <cstring>
+#include <limits>
 
 namespace LightGBM {
 
@@ -211,8 +214,10 @@ std::string Tree::ToString() const {
   str_buf << "num_cat=" << num_cat_ << std::endl;
   str_buf << "split_feature="
     << Common::ArrayToString<int>(split_feature_, num_leaves_ - 1, ' ') << std::endl;
-  str_buf << "split_gain="
-    << Common::ArrayToString<double>(split_gain_, num_leaves_ - 1, ' ') << std::endl;
+  if (has_training_info()) {
+    str_buf << "split_gain="
+      << Common::ArrayToString<double>(split_gain_, num_leaves_ - 1, ' ') << std::endl;
+  }
   str_buf << "threshold="
     << Common::ArrayToString<double>(threshold_, num_leaves_ - 1, ' ') << std::endl;
   str_buf << "decision_type="
@@ -223,12 +228,14 @@ std::string Tree::ToString() const {
     << Common::ArrayToString<int>(right_child_, num_leaves_ - 1, ' ') << std::endl;
   str_buf << "leaf_value="
     << Common::ArrayToString<double>(leaf_value_, num_leaves_, ' ') << std::endl;
-  str_buf << "leaf_count="
-    << Common::ArrayToString<data_size_t>(leaf_count_, num_leaves_, ' ') << std::endl;
-  str_buf << "internal_value="
-    << Common::ArrayToString<double>(internal_value_, num_leaves_ - 1, ' ') << std::endl;
-  str_buf << "internal_count="
-    << Common::ArrayToString<data_size_t>(internal_count_, num_leaves_ - 1, ' ') << std::endl;
+  if (has_training_info()) {
+    str_buf << "leaf_count="
+      << Common::ArrayToString<data_size_t>(leaf_count_, num_leaves_, ' ') << std::endl;
+    str_buf << "internal_value="
+      << Common::ArrayToString<double>(internal_value_, num_leaves_ - 1, ' ') << std::endl;
+    str_buf << "internal_count="
+      << Common::ArrayToString<data_size_t>(internal_count_, num_leaves_ - 1, ' ') << std::endl;
+  }
   if (num_cat_ > 0) {
     str_buf << "cat_boundaries="
       << Common::ArrayToString<int>(cat_boundaries_, num_cat_ + 1, ' ') << std::endl;
@@ -263,7 +270,9 @@ std::string Tree::NodeToJSON(int index) const {
     str_buf << "{" << std::endl;
     str_buf << "\"split_index\":" << index << "," << std::endl;
     str_buf << "\"split_feature\":" << split_feature_[index] << "," << std::endl;
-    str_buf << "\"split_gain\":" << split_gain_[index] << "," << std::endl;
+    if (has_training_info()) {
+      str_buf << "\"split_gain\":" << split_gain_[index] << "," << std::endl;
+    }
     if (GetDecisionType(decision_type_[index], kCategoricalMask)) {
       int cat_idx = static_cast<int>(threshold_[index]);
       std::vector<int> cats;
@@ -295,8 +304,10 @@ std::string Tree::NodeToJSON(int index) const {
     } else {
       str_buf << "\"missing_type\":\"NaN\"," << std::endl;
     }
-    str_buf << "\"internal_value\":" << internal_value_[index] << "," << std::endl;
-    str_buf << "\"internal_count\":" << internal_count_[index] << "," << std::endl;
+    if (has_training_info()) {
+      str_buf << "\"internal_value\":" << internal_value_[index] << "," << std::endl;
+      str_buf << "\"internal_count\":" << internal_count_[index] << "," << std::endl;
+    }
     str_buf << "\"left_child\":" << NodeToJSON(left_child_[index]) << "," << std::endl;
     str_buf << "\"right_child\":" << NodeToJSON(right_child_[index]) << std::endl;
     str_buf << "}";
@@ -305,8 +316,12 @@ std::string Tree::NodeToJSON(int index) const {
     index = ~index;
     str_buf << "{" << std::endl;
     str_buf << "\"leaf_index\":" << index << "," << std::endl;
-    str_buf << "\"leaf_value\":" << leaf_value_[index] << "," << std::endl;
-    str_buf << "\"leaf_count\":" << leaf_count_[index] << std::endl;
+    if (has_training_info()) {
+      str_buf << "\"leaf_value\":" << leaf_value_[index] << "," << std::endl;
+      str_buf << "\"leaf_count\":" << leaf_count_[index] << std::endl;
+    } else {
+      str_buf << "\"leaf_value\":" << leaf_value_[index] << std::endl;
+    }
     str_buf << "}";
   }
 
@@ -411,6 +426,144 @@ std::string Tree::NodeToIfElse(int index, bool is_predict_leaf_index) const {
   return str_buf.str();
 }
 
+std::string Tree::ToNodeTable(int node_offset, const std::vector<int>& feature_slot,
+                              std::vector<uint32_t>* cat_threshold) const {
+  std::stringstream str_buf;
+  str_buf << std::setprecision(std::numeric_limits<double>::digits10 + 2);
+  const int num_internal = num_leaves_ - 1;
+  auto row_of = [node_offset, num_internal](int node) {
+    return node >= 0 ? node_offset + node : node_offset + num_internal + ~node;
+  };
+  // row layout: {value, {left, right}, slot, decision_type, cat_words}
+  for (int i = 0; i < num_internal; ++i) {
+    str_buf << "  {";
+    int cat_words = 0;
+    if (GetDecisionType(decision_type_[i], kCategoricalMask)) {
+      // value holds the offset of the bitset in the shared categorical threshold table
+      int cat_idx = static_cast<int>(threshold_[i]);
+      str_buf << cat_threshold->size();
+      for (int j = cat_boundaries_[cat_idx]; j < cat_boundaries_[cat_idx + 1]; ++j) {
+        cat_threshold->push_back(cat_threshold_[j]);
+      }
+      cat_words = cat_boundaries_[cat_idx + 1] - cat_boundaries_[cat_idx];
+    } else {
+      str_buf << threshold_[i];
+    }
+    str_buf << ", {" << row_of(left_child_[i]) << ", " << row_of(right_child_[i]) << "}, ";
+    str_buf << feature_slot[split_feature_[i]] << ", " << static_cast<int>(decision_type_[i]) << ", ";
+    str_buf << cat_words << "}," << std::endl;
+  }
+  // leaves loop back to themselves, so a fixed number of steps always ends on the right leaf
+  for (int i = 0; i < num_leaves_; ++i) {
+    const int row = node_offset + num_internal + i;
+    str_buf << "  {" << leaf_value_[i] << ", {" << row << ", " << row << "}, 0, 0, 0}," << std::endl;
+  }
+  return str_buf.str();
+}
+
+namespace {
+
+/*! \brief Smallest byte width (1, 2 or 4) that holds [min_value, max_value], unsigned if min_value >= 0 */
+int IntBytes(int64_t min_value, int64_t max_value) {
+  if (min_value >= 0) {
+    if (max_value <= std::numeric_limits<uint8_t>::max()) { return 1; }
+    if (max_value <= std::numeric_limits<uint16_t>::max()) { return 2; }
+  } else {
+    if (min_value >= std::numeric_limits<int8_t>::min() && max_value <= std::numeric_limits<int8_t>::max()) { return 1; }
+    if (min_value >= std::numeric_limits<int16_t>::min() && max_value <= std::numeric_limits<int16_t>::max()) { return 2; }
+  }
+  return 4;
+}
+
+template<typename T>
+void AppendRaw(const T* data, size_t cnt, std::string* out) {
+  out->append(reinterpret_cast<const char*>(data), sizeof(T) * cnt);
+}
+
+void AppendInts(const std::vector<int>& values, int bytes, std::string* out) {
+  for (int value : values) {
+    if (bytes == 1) {
+      int8_t v = static_cast<int8_t>(value);
+      AppendRaw(&v, 1, out);
+    } else if (bytes == 2) {
+      int16_t v = static_cast<int16_t>(value);
+      AppendRaw(&v, 1, out);
+    } else {
+      int32_t v = static_cast<int32_t>(value);
+      AppendRaw(&v, 1, out);
+    }
+  }
+}
+
+std::vector<int> ReadInts(const char* p, int cnt, int bytes, bool is_signed) {
+  std::vector<int> ret(cnt);
+  for (int i = 0; i < cnt; ++i) {
+    if (bytes == 1) {
+      ret[i] = is_signed ? static_cast<int>(static_cast<int8_t>(p[i])) : static_cast<int>(static_cast<uint8_t>(p[i]));
+    } else if (bytes == 2) {
+      uint16_t v;
+      std::memcpy(&v, p + 2 * i, sizeof(v));
+      ret[i] = is_signed ? static_cast<int>(static_cast<int16_t>(v)) : static_cast<int>(v);
+    } else {
+      int32_t v;
+      std::memcpy(&v, p + 4 * i, sizeof(v));
+      ret[i] = static_cast<int>(v);
+    }
+  }
+  return ret;
+}
+
+}  // namespace
+
+void Tree::AddThresholdsToDict(std::vector<std::vector<double>>* threshold_dict) const {
+  for (int i = 0; i < num_leaves_ - 1; ++i) {
+    if (!GetDecisionType(decision_type_[i], kCategoricalMask)) {
+      (*threshold_dict)[split_feature_[i]].push_back(threshold_[i]);
+    }
+  }
+}
+
+void Tree::ToInferenceBinary(const std::vector<std::vector<double>>& threshold_dict, std::string* out) const {
+  // layout: num_leaves, num_cat, shrinkage, leaf_value, then for a non-constant tree the byte widths,
+  // decision_type, left_child, right_child, split_feature, threshold index and the categorical bitsets
+  int32_t header[2] = { num_leaves_, num_cat_ };
+  AppendRaw(header, 2, out);
+  AppendRaw(&shrinkage_, 1, out);
+  AppendRaw(leaf_value_.data(), num_leaves_, out);
+  const int num_internal = num_leaves_ - 1;
+  if (num_internal <= 0) { return; }
+  // numerical thresholds are indices into the feature's dictionary, categorical ones already are indices
+  std::vector<int> threshold_idx(num_internal);
+  int max_feature = 0;
+  int max_threshold_idx = 0;
+  for (int i = 0; i < num_internal; ++i) {
+    if (GetDecisionType(decision_type_[i], kCategoricalMask)) {
+      threshold_idx[i] = static_cast<int>(threshold_[i]);
+    } else {
+      const auto& dict = threshold_dict[split_feature_[i]];
+      threshold_idx[i] = static_cast<int>(std::lower_bound(dict.begin(), dict.end(), threshold_[i]) - dict.begin());
+    }
+    max_feature = std::max(max_feature, split_feature_[i]);
+    max_threshold_idx = std::max(max_threshold_idx, threshold_idx[i]);
+  }
+  const std::vector<int> left_child(left_child_.begin(), left_child_.begin() + num_internal);
+  const std::vector<int> right_child(right_child_.begin(), right_child_.begin() + num_internal);
+  const std::vector<int> split_feature(split_feature_.begin(), split_feature_.begin() + num_internal);
+  uint8_t widths[4] = { static_cast<uint8_t>(IntBytes(-num_leaves_, num_internal)),
+                        static_cast<uint8_t>(IntBytes(0, max_feature)),
+                        static_cast<uint8_t>(IntBytes(0, max_threshold_idx)), 0 };
+  AppendRaw(widths, 4, out);
+  AppendRaw(decision_type_.data(), num_internal, out);
+  AppendInts(left_child, widths[0], out);
+  AppendInts(right_child, widths[0], out);
+  AppendInts(split_feature, widths[1], out);
+  AppendInts(threshold_idx, widths[2], out);
+  if (num_cat_ > 0) {
+    AppendRaw(cat_boundaries_.data(), num_cat_ + 1, out);
+    AppendRaw(cat_threshold_.data(), cat_threshold_.size(), out);
+  }
+}
+
 Tree::Tree(const std::string& str) {
   std::vector<std::string> lines = Common::SplitLines(str.c_str());
   std::unordered_map<std::string, std::string> key_vals;
@@ -468,28 +621,27 @@ Tree::Tree(const std::string& str) {
     Log::Fatal("Tree model string format error, should contain threshold field");
   }
 
+  // a tree saved without training info (from an inference model) keeps them empty, see has_training_info
   if (key_vals.count("split_gain")) {
     split_gain_ = Common::StringToArray<double>(key_vals["split_gain"], ' ', num_leaves_ - 1);
-  } else {
-    split_gain_.resize(num_leaves_ - 1);
-  }
 
-  if (key_vals.count("internal_count")) {
-    internal_count_ = Common::StringToArray<data_size_t>(key_vals["internal_count"], ' ', num_leaves_ - 1);
-  } else {
-    internal_count_.resize(num_leaves_ - 1);
-  }
+    if (key_vals.count("internal_count")) {
+      internal_count_ = Common::StringToArray<data_size_t>(key_vals["internal_count"], ' ', num_leaves_ - 1);
+    } else {
+      internal_count_.resize(num_leaves_ - 1);
+    }
 
-  if (key_vals.count("internal_value")) {
-    internal_value_ = Common::StringToArray<double>(key_vals["internal_value"], ' ', num_leaves_ - 1);
-  } else {
-    internal_value_.resize(num_leaves_ - 1);
-  }
+    if (key_vals.count("internal_value")) {
+      internal_value_ = Common::StringToArray<double>(key_vals["internal_value"], ' ', num_leaves_ - 1);
+    } else {
+      internal_value_.resize(num_leaves_ - 1);
+    }
 
-  if (key_vals.count("leaf_count")) {
-    leaf_count_ = Common::StringToArray<data_size_t>(key_vals["leaf_count"], ' ', num_leaves_);
-  } else {
-    leaf_count_.resize(num_leaves_);
+    if (key_vals.count("leaf_count")) {
+      leaf_count_ = Common::StringToArray<data_size_t>(key_vals["leaf_count"], ' ', num_leaves_);
+    } else {
+      leaf_count_.resize(num_leaves_);
+    }
   }
 
   if (key_vals.count("decision_type")) {
@@ -519,6 +671,65 @@ Tree::Tree(const std::string& str) {
   }
 }
 
+Tree::Tree(const char* buffer, size_t size, const std::vector<std::vector<double>>& threshold_dict, size_t* used_size) {
+  const char* ptr = buffer;
+  auto take = [&ptr, buffer, size](size_t bytes) {
+    if (static_cast<size_t>(ptr - buffer) + bytes > size) {
+      Log::Fatal("Inference model format error, tree is truncated");
+    }
+    const char* ret = ptr;
+    ptr += bytes;
+    return ret;
+  };
+  int32_t header[2];
+  std::memcpy(header, take(sizeof(header)), sizeof(header));
+  num_leaves_ = header[0];
+  num_cat_ = header[1];
+  max_leaves_ = num_leaves_;
+  if (num_leaves_ < 1 || num_cat_ < 0) {
+    Log::Fatal("Inference model format error, wrong tree header");
+  }
+  std::memcpy(&shrinkage_, take(sizeof(double)), sizeof(double));
+  leaf_value_.resize(num_leaves_);
+  std::memcpy(leaf_value_.data(), take(sizeof(double) * num_leaves_), sizeof(double) * num_leaves_);
+  const int num_internal = num_leaves_ - 1;
+  if (num_internal > 0) {
+    uint8_t widths[4];
+    std::memcpy(widths, take(sizeof(widths)), sizeof(widths));
+    for (int i = 0; i < 3; ++i) {
+      if (widths[i] != 1 && widths[i] != 2 && widths[i] != 4) {
+        Log::Fatal("Inference model format error, wrong integer width %d", static_cast<int>(widths[i]));
+      }
+    }
+    decision_type_.resize(num_internal);
+    std::memcpy(decision_type_.data(), take(num_internal), num_internal);
+    left_child_ = ReadInts(take(widths[0] * num_internal), num_internal, widths[0], true);
+    right_child_ = ReadInts(take(widths[0] * num_internal), num_internal, widths[0], true);
+    split_feature_ = ReadInts(take(widths[1] * num_internal), num_internal, widths[1], false);
+    std::vector<int> threshold_idx = ReadInts(take(widths[2] * num_internal), num_internal, widths[2], false);
+    threshold_.resize(num_internal);
+    for (int i = 0; i < num_internal; ++i) {
+      if (GetDecisionType(decision_type_[i], kCategoricalMask)) {
+        threshold_[i] = threshold_idx[i];
+      } else {
+        if (split_feature_[i] >= static_cast<int>(threshold_dict.size())
+            || threshold_idx[i] >= static_cast<int>(threshold_dict[split_feature_[i]].size())) {
+          Log::Fatal("Inference model format error, threshold is not in the dictionary");
+        }
+        threshold_[i] = threshold_dict[split_feature_[i]][threshold_idx[i]];
+      }
+    }
+    if (num_cat_ > 0) {
+      cat_boundaries_.resize(num_cat_ + 1);
+      std::memcpy(cat_boundaries_.data(), take(sizeof(int) * (num_cat_ + 1)), sizeof(int) * (num_cat_ + 1));
+      cat_threshold_.resize(cat_boundaries_.back());
+      std::memcpy(cat_threshold_.data(), take(sizeof(uint32_t) * cat_threshold_.size()),
+                  sizeof(uint32_t) * cat_threshold_.size());
+    }
+  }
+  *used_size = static_cast<size_t>(ptr - buffer);
+}
+
 void Tree::ExtendPath(PathElement *unique_path, int unique_depth,
                       double zero_fraction, double one_fraction, int feature_index) {
   unique_path[unique_depth].feature_index = feature_index;
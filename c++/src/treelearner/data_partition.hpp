@@ -8,6 +8,8 @@
 
 #include <cstring>
 
+#include <algorithm>
+#include <utility>
 #include <vector>
 
 namespace LightGBM {
@@ -90,8 +92,13 @@ public:
   * \param feature_bins feature bin data
   * \param threshold threshold that want to split
   * \param right_leaf index of right leaf
+  * \param gradients If not nullptr, the gradients of the smaller child are gathered to ordered_gradients
+  *        in the order of its indices while they are copied back
+  * \param hessians If not nullptr, the hessians of the smaller child are gathered to ordered_hessians
   */
-  void Split(int leaf, const Dataset* dataset, int feature, const uint32_t* threshold, int num_threshold, bool default_left, int right_leaf) {
+  void Split(int leaf, const Dataset* dataset, int feature, const uint32_t* threshold, int num_threshold, bool default_left, int right_leaf,
+             const score_t* gradients = nullptr, const score_t* hessians = nullptr,
+             score_t* ordered_gradients = nullptr, score_t* ordered_hessians = nullptr) {
     const data_size_t min_inner_size = 512;
     // get leaf boundary
     const data_size_t begin = leaf_begin_[leaf];
@@ -127,16 +134,26 @@ public:
       right_write_pos_buf_[i] = right_write_pos_buf_[i - 1] + right_cnts_buf_[i - 1];
     }
     left_cnt = left_write_pos_buf_[num_threads_ - 1] + left_cnts_buf_[num_threads_ - 1];
+    // same rule as the learner uses to choose the smaller leaf
+    const bool is_left_smaller = left_cnt < cnt - left_cnt;
     // copy back indices of right leaf to indices_
     #pragma omp parallel for schedule(static, 1)
     for (int i = 0; i < num_threads_; ++i) {
       if (left_cnts_buf_[i] > 0) {
         std::memcpy(indices_.data() + begin + left_write_pos_buf_[i],
                     temp_left_indices_.data() + offsets_buf_[i], left_cnts_buf_[i] * sizeof(data_size_t));
+        if (is_left_smaller) {
+          Gather(temp_left_indices_.data() + offsets_buf_[i], left_cnts_buf_[i], gradients, hessians,
+                 ordered_gradients, ordered_hessians, left_write_pos_buf_[i]);
+        }
       }
       if (right_cnts_buf_[i] > 0) {
         std::memcpy(indices_.data() + begin + left_cnt + right_write_pos_buf_[i],
                     temp_right_indices_.data() + offsets_buf_[i], right_cnts_buf_[i] * sizeof(data_size_t));
+        if (!is_left_smaller) {
+          Gather(temp_right_indices_.data() + offsets_buf_[i], right_cnts_buf_[i], gradients, hessians,
+                 ordered_gradients, ordered_hessians, right_write_pos_buf_[i]);
+        }
       }
     }
     // update leaf boundary
@@ -145,6 +162,102 @@ public:
     leaf_count_[right_leaf] = cnt - left_cnt;
   }
 
+  /*! \brief Split of one leaf, for splitting several leaves at once */
+  struct LeafSplit {
+    int leaf;
+    int feature;
+    std::vector<uint32_t> threshold;
+    bool default_left;
+    int right_leaf;
+  };
+
+  /*!
+  * \brief Split the data of several leaves at once, the blocks of all leaves are partitioned in
+  *        one parallel loop and copied back in another one
+  * \param splits Splits of different leaves
+  * \param dataset Dataset to get the bins from
+  * \param gradients If not nullptr, the gradients of the smaller child of each split are gathered to
+  *        ordered_gradients at the same positions as its indices while they are copied back
+  * \param hessians If not nullptr, the hessians of the smaller children are gathered to ordered_hessians
+  */
+  void Split(const std::vector<LeafSplit>& splits, const Dataset* dataset,
+             const score_t* gradients = nullptr, const score_t* hessians = nullptr,
+             score_t* ordered_gradients = nullptr, score_t* ordered_hessians = nullptr) {
+    const data_size_t min_inner_size = 512;
+    // blocks of all leaves, (index of split, start in the leaf)
+    std::vector<std::pair<int, data_size_t>> blocks;
+    std::vector<data_size_t> inner_sizes(splits.size());
+    for (int j = 0; j < static_cast<int>(splits.size()); ++j) {
+      const data_size_t cnt = leaf_count_[splits[j].leaf];
+      inner_sizes[j] = std::max((cnt + num_threads_ - 1) / num_threads_, min_inner_size);
+      for (data_size_t start = 0; start < cnt; start += inner_sizes[j]) {
+        blocks.emplace_back(j, start);
+      }
+    }
+    const int num_blocks = static_cast<int>(blocks.size());
+    std::vector<data_size_t> left_cnts(num_blocks);
+    std::vector<data_size_t> right_cnts(num_blocks);
+    OMP_INIT_EX();
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < num_blocks; ++i) {
+      OMP_LOOP_EX_BEGIN();
+      const LeafSplit& split = splits[blocks[i].first];
+      const data_size_t begin = leaf_begin_[split.leaf];
+      const data_size_t cur_start = begin + blocks[i].second;
+      const data_size_t cur_cnt = std::min(inner_sizes[blocks[i].first], leaf_count_[split.leaf] - blocks[i].second);
+      // the leaves don't overlap, so their blocks use the same positions of the buffers as of indices_
+      left_cnts[i] = dataset->Split(split.feature, split.threshold.data(), static_cast<int>(split.threshold.size()),
+                                    split.default_left, indices_.data() + cur_start, cur_cnt,
+                                    temp_left_indices_.data() + cur_start, temp_right_indices_.data() + cur_start);
+      right_cnts[i] = cur_cnt - left_cnts[i];
+      OMP_LOOP_EX_END();
+    }
+    OMP_THROW_EX();
+    // write positions relative to the begin of the leaf, blocks of a leaf are consecutive
+    std::vector<data_size_t> left_write_pos(num_blocks);
+    std::vector<data_size_t> right_write_pos(num_blocks);
+    std::vector<data_size_t> left_total(splits.size(), 0);
+    std::vector<data_size_t> right_total(splits.size(), 0);
+    for (int i = 0; i < num_blocks; ++i) {
+      const int j = blocks[i].first;
+      left_write_pos[i] = left_total[j];
+      right_write_pos[i] = right_total[j];
+      left_total[j] += left_cnts[i];
+      right_total[j] += right_cnts[i];
+    }
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < num_blocks; ++i) {
+      const int j = blocks[i].first;
+      const data_size_t begin = leaf_begin_[splits[j].leaf];
+      const data_size_t cur_start = begin + blocks[i].second;
+      // same rule as the learner uses to choose the smaller leaf
+      const bool is_left_smaller = left_total[j] < right_total[j];
+      if (left_cnts[i] > 0) {
+        std::memcpy(indices_.data() + begin + left_write_pos[i],
+                    temp_left_indices_.data() + cur_start, left_cnts[i] * sizeof(data_size_t));
+        if (is_left_smaller) {
+          Gather(temp_left_indices_.data() + cur_start, left_cnts[i], gradients, hessians,
+                 ordered_gradients, ordered_hessians, begin + left_write_pos[i]);
+        }
+      }
+      if (right_cnts[i] > 0) {
+        std::memcpy(indices_.data() + begin + left_total[j] + right_write_pos[i],
+                    temp_right_indices_.data() + cur_start, right_cnts[i] * sizeof(data_size_t));
+        if (!is_left_smaller) {
+          Gather(temp_right_indices_.data() + cur_start, right_cnts[i], gradients, hessians,
+                 ordered_gradients, ordered_hessians, begin + left_total[j] + right_write_pos[i]);
+        }
+      }
+    }
+    // update leaf boundary
+    for (int j = 0; j < static_cast<int>(splits.size()); ++j) {
+      const int leaf = splits[j].leaf;
+      leaf_begin_[splits[j].right_leaf] = leaf_begin_[leaf] + left_total[j];
+      leaf_count_[splits[j].right_leaf] = right_total[j];
+      leaf_count_[leaf] = left_total[j];
+    }
+  }
+
   /*!
   * \brief SetLabelAt used data indices before training, used for bagging
   * \param used_data_indices indices of used data
@@ -175,6 +288,22 @@ public:
   int num_leaves() const { return num_leaves_; }
 
 private:
+  /*! \brief Gather the gradients and hessians of indices to position pos of the ordered buffers */
+  static inline void Gather(const data_size_t* indices, data_size_t cnt,
+                            const score_t* gradients, const score_t* hessians,
+                            score_t* ordered_gradients, score_t* ordered_hessians, data_size_t pos) {
+    if (gradients != nullptr) {
+      for (data_size_t i = 0; i < cnt; ++i) {
+        ordered_gradients[pos + i] = gradients[indices[i]];
+      }
+    }
+    if (hessians != nullptr) {
+      for (data_size_t i = 0; i < cnt; ++i) {
+        ordered_hessians[pos + i] = hessians[indices[i]];
+      }
+    }
+  }
+
   /*! \brief Number of all data */
   data_size_t num_data_;
   /*! \brief Number of all leaves */
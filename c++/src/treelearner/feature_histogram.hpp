@@ -6,7 +6,13 @@
 #include <LightGBM/utils/array_args.h>
 #include <LightGBM/dataset.h>
 
+#include <algorithm>
 #include <cstring>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 namespace LightGBM
 {
@@ -45,12 +51,15 @@ public:
   void Init(HistogramBinEntry* data, const FeatureMetainfo* meta, BinType bin_type) {
     meta_ = meta;
     data_ = data;
+    // capture only this, so the function is stored inline instead of on the heap for each feature of each leaf
     if (bin_type == BinType::NumericalBin) {
-      find_best_threshold_fun_ = std::bind(&FeatureHistogram::FindBestThresholdNumerical, this, std::placeholders::_1
-                                           , std::placeholders::_2, std::placeholders::_3, std::placeholders::_4);
+      find_best_threshold_fun_ = [this] (double sum_gradient, double sum_hessian, data_size_t num_data, SplitInfo* output) {
+        FindBestThresholdNumerical(sum_gradient, sum_hessian, num_data, output);
+      };
     } else {
-      find_best_threshold_fun_ = std::bind(&FeatureHistogram::FindBestThresholdCategorical, this, std::placeholders::_1
-                                           , std::placeholders::_2, std::placeholders::_3, std::placeholders::_4);
+      find_best_threshold_fun_ = [this] (double sum_gradient, double sum_hessian, data_size_t num_data, SplitInfo* output) {
+        FindBestThresholdCategorical(sum_gradient, sum_hessian, num_data, output);
+      };
     }
   }
 
@@ -506,9 +515,59 @@ public:
       std::fill(mapper_.begin(), mapper_.end(), -1);
       std::fill(inverse_mapper_.begin(), inverse_mapper_.end(), -1);
       std::fill(last_used_time_.begin(), last_used_time_.end(), 0);
+      sparse_histograms_.clear();
+      sparse_bytes_ = 0;
+    }
+  }
+
+  /*!
+  * \brief Set the memory budget of the pool to histogram_pool_size, no limit when it is 0. When it is < 0,
+  *        the budget is kAutoPoolMemoryFraction of the available memory if the histograms of all leaves
+  *        don't fit in that, otherwise there is no limit
+  */
+  void ResetPoolSize(const Dataset* train_data, const TreeConfig* tree_config) {
+    if (tree_config->histogram_pool_size > 0) {
+      pool_size_ = tree_config->histogram_pool_size;
+      return;
+    }
+    pool_size_ = -1.0f;
+    if (tree_config->histogram_pool_size == 0) {
+      return;
+    }
+    double available_size = AvailableMemorySize();
+    if (available_size <= 0) {
+      return;
+    }
+    // the memory of the pool itself can be reused
+    for (const auto& data : data_) {
+      available_size += static_cast<double>(data.size() * sizeof(HistogramBinEntry)) / (1024 * 1024);
+    }
+    available_size += static_cast<double>(sparse_bytes_) / (1024 * 1024);
+    const double full_size = static_cast<double>(TotalHistogramSize(train_data)) * tree_config->num_leaves / (1024 * 1024);
+    if (full_size > available_size * kAutoPoolMemoryFraction) {
+      pool_size_ = available_size * kAutoPoolMemoryFraction;
+      Log::Info("Histograms of all leaves need %f MB, the histogram pool is limited to %f MB of %f MB available memory",
+                full_size, pool_size_, available_size);
     }
   }
 
+  /*!
+  * \brief Number of histograms of all features that fit in the dense part of the pool budget, see ResetPoolSize
+  * \return Cache size, at least 2 and at most num_leaves
+  */
+  int CacheSize(const Dataset* train_data, const TreeConfig* tree_config) const {
+    int max_cache_size = 0;
+    if (pool_size_ <= 0) {
+      max_cache_size = tree_config->num_leaves;
+    } else {
+      const double dense_size = pool_size_ * (1.0f - tree_config->histogram_pool_sparse_fraction);
+      max_cache_size = static_cast<int>(dense_size * 1024 * 1024 / TotalHistogramSize(train_data));
+    }
+    // at least need 2 leaves, and the children of all leaves split in a batch
+    max_cache_size = std::max(2 * tree_config->leaf_batch_size, max_cache_size);
+    return std::min(max_cache_size, tree_config->num_leaves);
+  }
+
   void DynamicChangeSize(const Dataset* train_data, const TreeConfig* tree_config, int cache_size, int total_size) {
     if (feature_metas_.empty()) {
       int num_feature = train_data->num_features();
@@ -530,6 +589,7 @@ public:
     Log::Info("Total Bins %d", num_total_bin);
     int old_cache_size = static_cast<int>(pool_.size());
     Reset(cache_size, total_size);
+    SetSparseBudget(tree_config);
 
     if (cache_size > old_cache_size) {
       pool_.resize(cache_size);
@@ -564,6 +624,7 @@ public:
     for (int i = 0; i < size; ++i) {
       feature_metas_[i].tree_config = tree_config;
     }
+    SetSparseBudget(tree_config);
   }
   /*!
   * \brief Get data for the specific index
@@ -586,13 +647,16 @@ public:
       *out = pool_[slot].get();
       last_used_time_[slot] = ++cur_time_;
 
-      // reset previous mapper
-      if (inverse_mapper_[slot] >= 0) mapper_[inverse_mapper_[slot]] = -1;
+      // reset previous mapper, and keep its histogram sparsely
+      if (inverse_mapper_[slot] >= 0) {
+        SaveSparse(inverse_mapper_[slot], slot);
+        mapper_[inverse_mapper_[slot]] = -1;
+      }
 
       // update current mapper
       mapper_[idx] = slot;
       inverse_mapper_[slot] = idx;
-      return false;
+      return RestoreSparse(idx, slot);
     }
   }
 
@@ -607,6 +671,11 @@ public:
       return;
     }
     if (mapper_[src_idx] < 0) {
+      auto it = sparse_histograms_.find(src_idx);
+      if (it != sparse_histograms_.end()) {
+        sparse_histograms_[dst_idx] = std::move(it->second);
+        sparse_histograms_.erase(src_idx);
+      }
       return;
     }
     // get slot of src idx
@@ -620,6 +689,113 @@ public:
     inverse_mapper_[slot] = dst_idx;
   }
 private:
+  /*! \brief Non-empty bins of an evicted histogram */
+  struct SparseHistogram {
+    std::vector<uint32_t> indices;
+    std::vector<HistogramBinEntry> entries;
+    std::vector<int8_t> is_splittable;
+    int evict_time = 0;
+
+    size_t bytes() const {
+      return indices.size() * sizeof(uint32_t) + entries.size() * sizeof(HistogramBinEntry) + is_splittable.size();
+    }
+  };
+
+  /*! \brief Fraction of the available memory for the pool when histogram_pool_size is not set */
+  static constexpr double kAutoPoolMemoryFraction = 0.5;
+
+  /*! \brief Size in bytes of the histograms of all features of a leaf, with their FeatureHistogram */
+  static size_t TotalHistogramSize(const Dataset* train_data) {
+    size_t total_histogram_size = 0;
+    for (int i = 0; i < train_data->num_features(); ++i) {
+      total_histogram_size += sizeof(FeatureHistogram) + sizeof(HistogramBinEntry) * train_data->FeatureNumBin(i);
+    }
+    return total_histogram_size;
+  }
+
+  /*! \brief Available physical memory in MB, < 0 if unknown */
+  static double AvailableMemorySize() {
+#if !defined(_WIN32) && defined(_SC_AVPHYS_PAGES)
+    const long num_pages = sysconf(_SC_AVPHYS_PAGES);
+    const long page_size = sysconf(_SC_PAGESIZE);
+    if (num_pages > 0 && page_size > 0) {
+      return static_cast<double>(num_pages) * page_size / (1024 * 1024);
+    }
+#endif
+    return -1.0f;
+  }
+
+  void SetSparseBudget(const TreeConfig* tree_config) {
+    if (pool_size_ <= 0) {
+      sparse_budget_ = 0;
+    } else {
+      sparse_budget_ = static_cast<size_t>(pool_size_ * tree_config->histogram_pool_sparse_fraction * 1024 * 1024);
+    }
+  }
+
+  /*!
+  * \brief Keep the non-empty bins of the histogram of idx in slot, drop the oldest kept histograms
+  *        when they don't fit in the budget
+  */
+  void SaveSparse(int idx, int slot) {
+    if (sparse_budget_ == 0) {
+      return;
+    }
+    const std::vector<HistogramBinEntry>& data = data_[slot];
+    SparseHistogram sparse;
+    for (size_t i = 0; i < data.size(); ++i) {
+      if (data[i].cnt != 0) {
+        sparse.indices.push_back(static_cast<uint32_t>(i));
+        sparse.entries.push_back(data[i]);
+      }
+    }
+    const int num_feature = static_cast<int>(feature_metas_.size());
+    sparse.is_splittable.resize(num_feature);
+    for (int i = 0; i < num_feature; ++i) {
+      sparse.is_splittable[i] = pool_[slot][i].is_splittable() ? 1 : 0;
+    }
+    sparse.evict_time = cur_time_;
+    const size_t bytes = sparse.bytes();
+    while (!sparse_histograms_.empty() && sparse_bytes_ + bytes > sparse_budget_) {
+      auto oldest = sparse_histograms_.begin();
+      for (auto it = sparse_histograms_.begin(); it != sparse_histograms_.end(); ++it) {
+        if (it->second.evict_time < oldest->second.evict_time) {
+          oldest = it;
+        }
+      }
+      sparse_bytes_ -= oldest->second.bytes();
+      sparse_histograms_.erase(oldest);
+    }
+    if (sparse_bytes_ + bytes > sparse_budget_) {
+      return;
+    }
+    sparse_bytes_ += bytes;
+    sparse_histograms_[idx] = std::move(sparse);
+  }
+
+  /*!
+  * \brief Restore the kept histogram of idx to slot
+  * \return False if the histogram of idx was not kept
+  */
+  bool RestoreSparse(int idx, int slot) {
+    auto it = sparse_histograms_.find(idx);
+    if (it == sparse_histograms_.end()) {
+      return false;
+    }
+    const SparseHistogram& sparse = it->second;
+    std::vector<HistogramBinEntry>& data = data_[slot];
+    std::fill(data.begin(), data.end(), HistogramBinEntry());
+    for (size_t i = 0; i < sparse.indices.size(); ++i) {
+      data[sparse.indices[i]] = sparse.entries[i];
+    }
+    for (size_t i = 0; i < sparse.is_splittable.size(); ++i) {
+      pool_[slot][i].set_is_splittable(sparse.is_splittable[i] != 0);
+    }
+    sparse_bytes_ -= sparse.bytes();
+    sparse_histograms_.erase(it);
+    return true;
+  }
+
   std::vector<std::unique_ptr<FeatureHistogram[]>> pool_;
   std::vector<std::vector<HistogramBinEntry>> data_;
   std::vector<FeatureMetainfo> feature_metas_;
@@ -630,6 +806,12 @@ private:
   std::vector<int> inverse_mapper_;
   std::vector<int> last_used_time_;
   int cur_time_ = 0;
+  /*! \brief Evicted histograms by leaf index */
+  std::unordered_map<int, SparseHistogram> sparse_histograms_;
+  size_t sparse_bytes_ = 0;
+  size_t sparse_budget_ = 0;
+  /*! \brief Memory budget of the pool in MB, < 0 means no limit */
+  double pool_size_ = -1.0f;
 };
 
 }  // namespace LightGBM
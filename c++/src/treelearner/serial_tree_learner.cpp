@@ -3,6 +3,7 @@
 #include <LightGBM/utils/array_args.h>
 
 #include <algorithm>
+#include <limits>
 #include <vector>
 
 namespace LightGBM {
@@ -19,6 +20,7 @@ std::chrono::duration<double, std::milli> ordered_bin_time;
 SerialTreeLearner::SerialTreeLearner(const TreeConfig* tree_config)
   :tree_config_(tree_config) {
   random_ = Random(tree_config_->feature_fraction_seed);
+  quant_random_ = Random(tree_config_->feature_fraction_seed + 1);
   #pragma omp parallel
   #pragma omp master
   {
@@ -42,27 +44,24 @@ void SerialTreeLearner::Init(const Dataset* train_data, bool is_constant_hessian
   num_data_ = train_data_->num_data();
   num_features_ = train_data_->num_features();
   is_constant_hessian_ = is_constant_hessian;
-  int max_cache_size = 0;
   // Get the max size of pool
-  if (tree_config_->histogram_pool_size <= 0) {
-    max_cache_size = tree_config_->num_leaves;
-  } else {
-    size_t total_histogram_size = 0;
-    for (int i = 0; i < train_data_->num_features(); ++i) {
-      total_histogram_size += sizeof(HistogramBinEntry) * train_data_->FeatureNumBin(i);
-    }
-    max_cache_size = static_cast<int>(tree_config_->histogram_pool_size * 1024 * 1024 / total_histogram_size);
-  }
-  // at least need 2 leaves
-  max_cache_size = std::max(2, max_cache_size);
-  max_cache_size = std::min(max_cache_size, tree_config_->num_leaves);
+  histogram_pool_.ResetPoolSize(train_data_, tree_config_);
+  const int max_cache_size = histogram_pool_.CacheSize(train_data_, tree_config_);
 
   histogram_pool_.DynamicChangeSize(train_data_, tree_config_, max_cache_size, tree_config_->num_leaves);
   // push split information for all leaves
   best_split_per_leaf_.resize(tree_config_->num_leaves);
 
-  // get ordered bin
-  train_data_->CreateOrderedBins(&ordered_bins_);
+  // use row-wise histograms when a row has non-zero bins in few of the groups
+  const double nnz_per_row = train_data_->ExpectedNonZeroGroupsPerRow();
+  is_row_wise_ = tree_config_->force_row_wise
+    || (!tree_config_->force_col_wise && nnz_per_row * kRowWiseGroupRatio < train_data_->num_feature_groups());
+  if (is_row_wise_) {
+    Log::Info("Use row-wise histograms, %f non-zero groups per row in %d groups",
+              nnz_per_row, train_data_->num_feature_groups());
+  }
+  // get ordered bin, or the bins by row
+  ResetRowWiseBins();
 
   // check existing for ordered bin
   for (int i = 0; i < static_cast<int>(ordered_bins_.size()); ++i) {
@@ -77,7 +76,22 @@ void SerialTreeLearner::Init(const Dataset* train_data, bool is_constant_hessian
 
   // initialize data partition
   data_partition_.reset(new DataPartition(num_data_, tree_config_->num_leaves));
-  is_feature_used_.resize(num_features_);
+  is_feature_used_.assign(num_features_, 0);
+  used_feature_indices_.clear();
+  is_feature_used_in_leaf_.assign(num_features_, 0);
+  leaf_feature_indices_.clear();
+  // the cost of searching a feature is about its number of bins
+  split_feature_order_.resize(num_features_);
+  for (int i = 0; i < num_features_; ++i) {
+    split_feature_order_[i] = i;
+  }
+  std::stable_sort(split_feature_order_.begin(), split_feature_order_.end(), [this] (int a, int b) {
+    return train_data_->FeatureNumBin(a) > train_data_->FeatureNumBin(b);
+  });
+  split_feature_rank_.resize(num_features_);
+  for (int i = 0; i < num_features_; ++i) {
+    split_feature_rank_[split_feature_order_[i]] = i;
+  }
   // initialize ordered gradients and hessians
   ordered_gradients_.resize(num_data_);
   ordered_hessians_.resize(num_data_);
@@ -92,6 +106,7 @@ void SerialTreeLearner::Init(const Dataset* train_data, bool is_constant_hessian
       }
     }
   }
+  ResetGradientQuantization();
   Log::Info("Number of data: %d, number of used features: %d", num_data_, num_features_);
 }
 
@@ -100,8 +115,8 @@ void SerialTreeLearner::ResetTrainingData(const Dataset* train_data) {
   num_data_ = train_data_->num_data();
   CHECK(num_features_ == train_data_->num_features());
 
-  // get ordered bin
-  train_data_->CreateOrderedBins(&ordered_bins_);
+  // get ordered bin, or the bins by row
+  ResetRowWiseBins();
 
   // initialize splits for leaf
   smaller_leaf_splits_->ResetNumData(num_data_);
@@ -118,25 +133,17 @@ void SerialTreeLearner::ResetTrainingData(const Dataset* train_data) {
     is_data_in_leaf_.resize(num_data_);
     std::fill(is_data_in_leaf_.begin(), is_data_in_leaf_.end(), static_cast<char>(0));
   }
+  ResetGradientQuantization();
 }
 
 void SerialTreeLearner::ResetConfig(const TreeConfig* tree_config) {
-  if (tree_config_->num_leaves != tree_config->num_leaves) {
+  if (tree_config_->num_leaves != tree_config->num_leaves
+      || tree_config_->leaf_batch_size != tree_config->leaf_batch_size
+      || tree_config_->histogram_pool_size != tree_config->histogram_pool_size) {
     tree_config_ = tree_config;
-    int max_cache_size = 0;
     // Get the max size of pool
-    if (tree_config->histogram_pool_size <= 0) {
-      max_cache_size = tree_config_->num_leaves;
-    } else {
-      size_t total_histogram_size = 0;
-      for (int i = 0; i < train_data_->num_features(); ++i) {
-        total_histogram_size += sizeof(HistogramBinEntry) * train_data_->FeatureNumBin(i);
-      }
-      max_cache_size = static_cast<int>(tree_config_->histogram_pool_size * 1024 * 1024 / total_histogram_size);
-    }
-    // at least need 2 leaves
-    max_cache_size = std::max(2, max_cache_size);
-    max_cache_size = std::min(max_cache_size, tree_config_->num_leaves);
+    histogram_pool_.ResetPoolSize(train_data_, tree_config_);
+    const int max_cache_size = histogram_pool_.CacheSize(train_data_, tree_config_);
     histogram_pool_.DynamicChangeSize(train_data_, tree_config_, max_cache_size, tree_config_->num_leaves);
 
     // push split information for all leaves
@@ -147,6 +154,89 @@ void SerialTreeLearner::ResetConfig(const TreeConfig* tree_config) {
   }
 
   histogram_pool_.ResetConfig(tree_config_);
+  ResetGradientQuantization();
+}
+
+void SerialTreeLearner::ResetRowWiseBins() {
+  if (!is_row_wise_) {
+    train_data_->CreateOrderedBins(&ordered_bins_);
+    return;
+  }
+  // the histograms of sparse groups are also built from the rows, ordered bins are not needed
+  ordered_bins_.clear();
+  ordered_bins_.resize(train_data_->num_feature_groups());
+  train_data_->CreateRowWiseBins(&row_ptr_, &row_bins_);
+}
+
+void SerialTreeLearner::ResetGradientQuantization() {
+  gradient_quant_bits_ = tree_config_->gradient_quant_bits;
+  if (gradient_quant_bits_ > 0 && is_row_wise_) {
+    Log::Warning("Gradients are not quantized with row-wise histograms");
+    gradient_quant_bits_ = 0;
+  }
+  if (gradient_quant_bits_ <= 0) {
+    packed_gradients_.clear();
+    ordered_packed_gradients_.clear();
+    quantized_histogram_.clear();
+    return;
+  }
+  // the sums of num_data_ quantized hessians have to fit in 32 bits
+  int max_bits = 0;
+  while (max_bits < 16 && (static_cast<int64_t>(num_data_) << (max_bits + 1)) <= (static_cast<int64_t>(1) << 32)) {
+    ++max_bits;
+  }
+  if (max_bits < 2) {
+    Log::Fatal("Too many data (%d) to quantize gradients", num_data_);
+  }
+  if (gradient_quant_bits_ > max_bits) {
+    Log::Warning("Use %d bits to quantize gradients, sums of %d bits would overflow with %d data",
+                 max_bits, gradient_quant_bits_, num_data_);
+    gradient_quant_bits_ = max_bits;
+  }
+  packed_gradients_.resize(num_data_);
+  ordered_packed_gradients_.resize(num_data_);
+  quantized_histogram_.resize(train_data_->NumTotalBin());
+}
+
+void SerialTreeLearner::QuantizeGradients() {
+  const int max_gradient = (1 << (gradient_quant_bits_ - 1)) - 1;
+  const int max_hessian = (1 << gradient_quant_bits_) - 1;
+  std::vector<double> thread_max_gradient(num_threads_, 0.0f);
+  std::vector<double> thread_max_hessian(num_threads_, 0.0f);
+  #pragma omp parallel for schedule(static)
+  for (data_size_t i = 0; i < num_data_; ++i) {
+    const int tid = omp_get_thread_num();
+    thread_max_gradient[tid] = std::max(thread_max_gradient[tid], static_cast<double>(std::fabs(gradients_[i])));
+    thread_max_hessian[tid] = std::max(thread_max_hessian[tid], static_cast<double>(std::fabs(hessians_[i])));
+  }
+  const double max_abs_gradient = *std::max_element(thread_max_gradient.begin(), thread_max_gradient.end());
+  const double max_abs_hessian = *std::max_element(thread_max_hessian.begin(), thread_max_hessian.end());
+  gradient_scale_ = max_abs_gradient > 0.0f ? max_abs_gradient / max_gradient : 1.0f;
+  hessian_scale_ = max_abs_hessian > 0.0f ? max_abs_hessian / max_hessian : 1.0f;
+  const double inv_gradient_scale = 1.0f / gradient_scale_;
+  const double inv_hessian_scale = 1.0f / hessian_scale_;
+  // a random generator per block, results don't depend on the number of threads
+  const int block_size = 1024;
+  const int num_blocks = (num_data_ + block_size - 1) / block_size;
+  const int seed = quant_random_.NextInt(0, std::numeric_limits<int>::max() - num_blocks);
+  #pragma omp parallel for schedule(static)
+  for (int block = 0; block < num_blocks; ++block) {
+    Random rand(seed + block);
+    const data_size_t start = block * block_size;
+    const data_size_t end = std::min(start + block_size, num_data_);
+    for (data_size_t i = start; i < end; ++i) {
+      // stochastic rounding, round up with the probability of the fraction, unbiased
+      const double g = gradients_[i] * inv_gradient_scale;
+      const double h = hessians_[i] * inv_hessian_scale;
+      const double floor_g = std::floor(g);
+      const double floor_h = std::floor(h);
+      int32_t int_g = static_cast<int32_t>(floor_g) + (rand.NextFloat() < g - floor_g ? 1 : 0);
+      int32_t int_h = static_cast<int32_t>(floor_h) + (rand.NextFloat() < h - floor_h ? 1 : 0);
+      int_g = std::max(-max_gradient, std::min(max_gradient, int_g));
+      int_h = std::max(0, std::min(max_hessian, int_h));
+      packed_gradients_[i] = QuantizedHistogramBinEntry::Pack(int_g, static_cast<uint32_t>(int_h));
+    }
+  }
 }
 
 Tree* SerialTreeLearner::Train(const score_t* gradients, const score_t *hessians, bool is_constant_hessian) {
@@ -156,6 +246,9 @@ Tree* SerialTreeLearner::Train(const score_t* gradients, const score_t *hessians
   #ifdef TIMETAG
   auto start_time = std::chrono::steady_clock::now();
   #endif
+  if (gradient_quant_bits_ > 0) {
+    QuantizeGradients();
+  }
   // some initial works before training
   BeforeTrain();
 
@@ -169,6 +262,11 @@ Tree* SerialTreeLearner::Train(const score_t* gradients, const score_t *hessians
   int cur_depth = 1;
   // only root leaf can be splitted on first time
   int right_leaf = -1;
+  if (tree_config_->leaf_batch_size > 1) {
+    GrowByBatches(tree.get(), &cur_depth);
+    Log::Debug("Trained a tree with leaves=%d and max_depth=%d", tree->num_leaves(), cur_depth);
+    return tree.release();
+  }
   for (int split = 0; split < tree_config_->num_leaves - 1; ++split) {
     #ifdef TIMETAG
     start_time = std::chrono::steady_clock::now();
@@ -235,24 +333,31 @@ void SerialTreeLearner::BeforeTrain() {
 
   // reset histogram pool
   histogram_pool_.ResetMap();
+  ordered_gradients_leaf_ = -1;
 
   if (tree_config_->feature_fraction < 1) {
     int used_feature_cnt = static_cast<int>(train_data_->num_total_features()*tree_config_->feature_fraction);
-    // initialize used features
-    std::memset(is_feature_used_.data(), 0, sizeof(int8_t) * num_features_);
+    // clear the used features of previous tree, the unsampled features are never touched
+    for (int feature_index : used_feature_indices_) {
+      is_feature_used_[feature_index] = 0;
+    }
     // Get used feature at current tree
     auto used_feature_indices = random_.Sample(train_data_->num_total_features(), used_feature_cnt);
-    int omp_loop_size = static_cast<int>(used_feature_indices.size());
-    #pragma omp parallel for schedule(static, 512) if (omp_loop_size >= 1024)
-    for (int i = 0; i < omp_loop_size; ++i) {
-      int inner_feature_index = train_data_->InnerFeatureIndex(used_feature_indices[i]);
+    used_feature_indices_.clear();
+    for (int real_feature_index : used_feature_indices) {
+      int inner_feature_index = train_data_->InnerFeatureIndex(real_feature_index);
       if (inner_feature_index < 0) { continue; }
       is_feature_used_[inner_feature_index] = 1;
+      used_feature_indices_.push_back(inner_feature_index);
     }
+    std::sort(used_feature_indices_.begin(), used_feature_indices_.end(), [this] (int a, int b) {
+      return split_feature_rank_[a] < split_feature_rank_[b];
+    });
   } else {
-    #pragma omp parallel for schedule(static, 512) if (num_features_ >= 1024)
-    for (int i = 0; i < num_features_; ++i) {
-      is_feature_used_[i] = 1;
+    // reset every tree, parallel learners change is_feature_used_ after this
+    std::memset(is_feature_used_.data(), 1, sizeof(int8_t) * num_features_);
+    if (used_feature_indices_.size() != split_feature_order_.size()) {
+      used_feature_indices_ = split_feature_order_;
     }
   }
 
@@ -404,20 +509,24 @@ bool SerialTreeLearner::BeforeFindBestSplit(const Tree* tree, int left_leaf, int
 }
 
 void SerialTreeLearner::FindBestSplits() {
-  std::vector<int8_t> is_feature_used(num_features_, 0);
-  #pragma omp parallel for schedule(static,1024) if (num_features_ >= 2048)
-  for (int feature_index = 0; feature_index < num_features_; ++feature_index) {
+  for (int feature_index : leaf_feature_indices_) {
+    is_feature_used_in_leaf_[feature_index] = 0;
+  }
+  leaf_feature_indices_.clear();
+  // only the features sampled for this tree
+  for (int feature_index : used_feature_indices_) {
     if (!is_feature_used_[feature_index]) continue;
     if (parent_leaf_histogram_array_ != nullptr
         && !parent_leaf_histogram_array_[feature_index].is_splittable()) {
       smaller_leaf_histogram_array_[feature_index].set_is_splittable(false);
       continue;
     }
-    is_feature_used[feature_index] = 1;
+    is_feature_used_in_leaf_[feature_index] = 1;
+    leaf_feature_indices_.push_back(feature_index);
   }
   bool use_subtract = parent_leaf_histogram_array_ != nullptr;
-  ConstructHistograms(is_feature_used, use_subtract);
-  FindBestSplitsFromHistograms(is_feature_used, use_subtract);
+  ConstructHistograms(is_feature_used_in_leaf_, use_subtract);
+  FindBestSplitsFromHistograms(is_feature_used_in_leaf_, use_subtract);
 }
 
 void SerialTreeLearner::ConstructHistograms(const std::vector<int8_t>& is_feature_used, bool use_subtract) {
@@ -426,12 +535,55 @@ void SerialTreeLearner::ConstructHistograms(const std::vector<int8_t>& is_featur
   #endif
   // construct smaller leaf
   HistogramBinEntry* ptr_smaller_leaf_hist_data = smaller_leaf_histogram_array_[0].RawData() - 1;
+  if (is_row_wise_) {
+    train_data_->ConstructRowWiseHistograms(row_ptr_, row_bins_,
+                                            smaller_leaf_splits_->data_indices(), smaller_leaf_splits_->num_data_in_leaf(),
+                                            gradients_, hessians_, is_constant_hessian_, num_threads_,
+                                            &row_wise_hist_buffer_, ptr_smaller_leaf_hist_data);
+    if (larger_leaf_histogram_array_ != nullptr && !use_subtract) {
+      // construct larger leaf
+      HistogramBinEntry* ptr_larger_leaf_hist_data = larger_leaf_histogram_array_[0].RawData() - 1;
+      train_data_->ConstructRowWiseHistograms(row_ptr_, row_bins_,
+                                              larger_leaf_splits_->data_indices(), larger_leaf_splits_->num_data_in_leaf(),
+                                              gradients_, hessians_, is_constant_hessian_, num_threads_,
+                                              &row_wise_hist_buffer_, ptr_larger_leaf_hist_data);
+    }
+    #ifdef TIMETAG
+    hist_time += std::chrono::steady_clock::now() - start_time;
+    #endif
+    return;
+  }
+  if (gradient_quant_bits_ > 0) {
+    train_data_->ConstructQuantizedHistograms(is_feature_used,
+                                              smaller_leaf_splits_->data_indices(), smaller_leaf_splits_->num_data_in_leaf(),
+                                              smaller_leaf_splits_->LeafIndex(),
+                                              ordered_bins_, packed_gradients_.data(), ordered_packed_gradients_.data(),
+                                              gradient_scale_, hessian_scale_, quantized_histogram_.data(),
+                                              ptr_smaller_leaf_hist_data);
+    if (larger_leaf_histogram_array_ != nullptr && !use_subtract) {
+      // construct larger leaf
+      HistogramBinEntry* ptr_larger_leaf_hist_data = larger_leaf_histogram_array_[0].RawData() - 1;
+      train_data_->ConstructQuantizedHistograms(is_feature_used,
+                                                larger_leaf_splits_->data_indices(), larger_leaf_splits_->num_data_in_leaf(),
+                                                larger_leaf_splits_->LeafIndex(),
+                                                ordered_bins_, packed_gradients_.data(), ordered_packed_gradients_.data(),
+                                                gradient_scale_, hessian_scale_, quantized_histogram_.data(),
+                                                ptr_larger_leaf_hist_data);
+    }
+    #ifdef TIMETAG
+    hist_time += std::chrono::steady_clock::now() - start_time;
+    #endif
+    return;
+  }
   train_data_->ConstructHistograms(is_feature_used,
                                    smaller_leaf_splits_->data_indices(), smaller_leaf_splits_->num_data_in_leaf(),
                                    smaller_leaf_splits_->LeafIndex(),
                                    ordered_bins_, gradients_, hessians_,
                                    ordered_gradients_.data(), ordered_hessians_.data(), is_constant_hessian_,
-                                   ptr_smaller_leaf_hist_data);
+                                   ptr_smaller_leaf_hist_data,
+                                   ordered_gradients_leaf_ == smaller_leaf_splits_->LeafIndex());
+  // the larger leaf gathers its own gradients to the same buffers
+  ordered_gradients_leaf_ = -1;
 
   if (larger_leaf_histogram_array_ != nullptr && !use_subtract) {
     // construct larger leaf
@@ -455,10 +607,12 @@ void SerialTreeLearner::FindBestSplitsFromHistograms(const std::vector<int8_t>&
   std::vector<SplitInfo> smaller_best(num_threads_);
   std::vector<SplitInfo> larger_best(num_threads_);
   OMP_INIT_EX();
-  // find splits
-  #pragma omp parallel for schedule(static)
-  for (int feature_index = 0; feature_index < num_features_; ++feature_index) {
+  // find splits, expensive features first and dynamically scheduled to balance the threads
+  const int num_used_features = static_cast<int>(used_feature_indices_.size());
+  #pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < num_used_features; ++i) {
     OMP_LOOP_EX_BEGIN();
+    const int feature_index = used_feature_indices_[i];
     if (!is_feature_used[feature_index]) { continue; }
     const int tid = omp_get_thread_num();
     SplitInfo smaller_split;
@@ -518,66 +672,383 @@ void SerialTreeLearner::FindBestSplitsFromHistograms(const std::vector<int8_t>&
 
 void SerialTreeLearner::Split(Tree* tree, int best_leaf, int* left_leaf, int* right_leaf) {
   const SplitInfo& best_split_info = best_split_per_leaf_[best_leaf];
-  const int inner_feature_index = train_data_->InnerFeatureIndex(best_split_info.feature);
   // left = parent
   *left_leaf = best_leaf;
+  // split tree, will return right leaf
+  std::vector<uint32_t> threshold;
+  *right_leaf = SplitTree(tree, best_leaf, &threshold);
+  if (!is_row_wise_ && gradient_quant_bits_ == 0) {
+    // gather the gradients of the smaller leaf for its histograms while partitioning
+    data_partition_->Split(best_leaf, train_data_, train_data_->InnerFeatureIndex(best_split_info.feature),
+                           threshold.data(), static_cast<int>(threshold.size()), best_split_info.default_left, *right_leaf,
+                           gradients_, is_constant_hessian_ ? nullptr : hessians_,
+                           ordered_gradients_.data(), ordered_hessians_.data());
+    ordered_gradients_leaf_ = data_partition_->leaf_count(*left_leaf) < data_partition_->leaf_count(*right_leaf)
+      ? *left_leaf : *right_leaf;
+  } else {
+    data_partition_->Split(best_leaf, train_data_, train_data_->InnerFeatureIndex(best_split_info.feature),
+                           threshold.data(), static_cast<int>(threshold.size()), best_split_info.default_left, *right_leaf);
+  }
+
+  #ifdef DEBUG
+  CHECK(best_split_info.left_count == data_partition_->leaf_count(best_leaf));
+  #endif
+
+  // init the leaves that used on next iteration
+  InitLeafSplits(best_split_info, *left_leaf, *right_leaf);
+}
+
+int SerialTreeLearner::SplitTree(Tree* tree, int best_leaf, std::vector<uint32_t>* threshold) {
+  const SplitInfo& best_split_info = best_split_per_leaf_[best_leaf];
+  const int inner_feature_index = train_data_->InnerFeatureIndex(best_split_info.feature);
   if (train_data_->FeatureBinMapper(inner_feature_index)->bin_type() == BinType::NumericalBin) {
     auto threshold_double = train_data_->RealThreshold(inner_feature_index, best_split_info.threshold);
-    // split tree, will return right leaf
-    *right_leaf = tree->Split(best_leaf,
-                              inner_feature_index,
-                              best_split_info.feature,
-                              best_split_info.threshold,
-                              threshold_double,
-                              static_cast<double>(best_split_info.left_output),
-                              static_cast<double>(best_split_info.right_output),
-                              static_cast<data_size_t>(best_split_info.left_count),
-                              static_cast<data_size_t>(best_split_info.right_count),
-                              static_cast<double>(best_split_info.gain),
-                              train_data_->FeatureBinMapper(inner_feature_index)->missing_type(),
-                              best_split_info.default_left);
-    data_partition_->Split(best_leaf, train_data_, inner_feature_index,
-                           &best_split_info.threshold, 1, best_split_info.default_left, *right_leaf);
+    threshold->assign(1, best_split_info.threshold);
+    return tree->Split(best_leaf,
+                       inner_feature_index,
+                       best_split_info.feature,
+                       best_split_info.threshold,
+                       threshold_double,
+                       static_cast<double>(best_split_info.left_output),
+                       static_cast<double>(best_split_info.right_output),
+                       static_cast<data_size_t>(best_split_info.left_count),
+                       static_cast<data_size_t>(best_split_info.right_count),
+                       static_cast<double>(best_split_info.gain),
+                       train_data_->FeatureBinMapper(inner_feature_index)->missing_type(),
+                       best_split_info.default_left);
   } else {
-    std::vector<uint32_t> cat_bitset_inner = Common::ConstructBitset(best_split_info.cat_threshold.data(), best_split_info.num_cat_threshold);
+    *threshold = Common::ConstructBitset(best_split_info.cat_threshold.data(), best_split_info.num_cat_threshold);
     std::vector<int> threshold_int(best_split_info.num_cat_threshold);
     for (int i = 0; i < best_split_info.num_cat_threshold; ++i) {
       threshold_int[i] = static_cast<int>(train_data_->RealThreshold(inner_feature_index, best_split_info.cat_threshold[i]));
     }
     std::vector<uint32_t> cat_bitset = Common::ConstructBitset(threshold_int.data(), best_split_info.num_cat_threshold);
-    *right_leaf = tree->SplitCategorical(best_leaf,
-                                         inner_feature_index,
-                                         best_split_info.feature,
-                                         cat_bitset_inner.data(),
-                                         static_cast<int>(cat_bitset_inner.size()),
-                                         cat_bitset.data(),
-                                         static_cast<int>(cat_bitset.size()),
-                                         static_cast<double>(best_split_info.left_output),
-                                         static_cast<double>(best_split_info.right_output),
-                                         static_cast<data_size_t>(best_split_info.left_count),
-                                         static_cast<data_size_t>(best_split_info.right_count),
-                                         static_cast<double>(best_split_info.gain),
-                                         train_data_->FeatureBinMapper(inner_feature_index)->missing_type());
-    data_partition_->Split(best_leaf, train_data_, inner_feature_index,
-                           cat_bitset_inner.data(), static_cast<int>(cat_bitset_inner.size()), best_split_info.default_left, *right_leaf);
+    return tree->SplitCategorical(best_leaf,
+                                  inner_feature_index,
+                                  best_split_info.feature,
+                                  threshold->data(),
+                                  static_cast<int>(threshold->size()),
+                                  cat_bitset.data(),
+                                  static_cast<int>(cat_bitset.size()),
+                                  static_cast<double>(best_split_info.left_output),
+                                  static_cast<double>(best_split_info.right_output),
+                                  static_cast<data_size_t>(best_split_info.left_count),
+                                  static_cast<data_size_t>(best_split_info.right_count),
+                                  static_cast<double>(best_split_info.gain),
+                                  train_data_->FeatureBinMapper(inner_feature_index)->missing_type());
   }
+}
 
-  #ifdef DEBUG
-  CHECK(best_split_info.left_count == data_partition_->leaf_count(best_leaf));
+void SerialTreeLearner::InitLeafSplits(const SplitInfo& split_info, int left_leaf, int right_leaf) {
+  if (split_info.left_count < split_info.right_count) {
+    smaller_leaf_splits_->Init(left_leaf, data_partition_.get(),
+                               split_info.left_sum_gradient,
+                               split_info.left_sum_hessian);
+    larger_leaf_splits_->Init(right_leaf, data_partition_.get(),
+                              split_info.right_sum_gradient,
+                              split_info.right_sum_hessian);
+  } else {
+    smaller_leaf_splits_->Init(right_leaf, data_partition_.get(), split_info.right_sum_gradient, split_info.right_sum_hessian);
+    larger_leaf_splits_->Init(left_leaf, data_partition_.get(), split_info.left_sum_gradient, split_info.left_sum_hessian);
+  }
+}
+
+void SerialTreeLearner::GrowByBatches(Tree* tree, int* cur_depth) {
+  #ifdef TIMETAG
+  auto start_time = std::chrono::steady_clock::now();
+  #endif
+  // root leaf
+  if (BeforeFindBestSplit(tree, 0, -1)) {
+    #ifdef TIMETAG
+    init_split_time += std::chrono::steady_clock::now() - start_time;
+    #endif
+    FindBestSplits();
+  }
+  if (static_cast<int>(batch_children_.size()) < tree_config_->leaf_batch_size) {
+    batch_children_.resize(tree_config_->leaf_batch_size);
+    for (auto& children : batch_children_) {
+      if (children.smaller_leaf_splits == nullptr) {
+        children.smaller_leaf_splits.reset(new LeafSplits(num_data_));
+        children.larger_leaf_splits.reset(new LeafSplits(num_data_));
+      }
+    }
+  }
+  // the histograms use the gradients gathered by the data partition, except by rows or quantized
+  const bool is_gradients_gathered = !is_row_wise_ && gradient_quant_bits_ == 0;
+  std::vector<int> batch;
+  std::vector<SplitInfo> batch_split_info;
+  std::vector<DataPartition::LeafSplit> leaf_splits;
+  std::vector<BatchChildren*> active_children;
+  std::vector<std::pair<int, int>> active_leaves;
+  while (tree->num_leaves() < tree_config_->num_leaves) {
+    // the leaves with the largest gains, ties are broken by leaf index like ArgMax
+    batch.clear();
+    for (int i = 0; i < tree->num_leaves(); ++i) {
+      if (best_split_per_leaf_[i].gain > 0.0) {
+        batch.push_back(i);
+      }
+    }
+    if (batch.empty()) {
+      Log::Warning("No further splits with positive gain, best gain: %f",
+                   best_split_per_leaf_[ArrayArgs<SplitInfo>::ArgMax(best_split_per_leaf_)].gain);
+      break;
+    }
+    std::stable_sort(batch.begin(), batch.end(), [this] (int a, int b) {
+      return best_split_per_leaf_[a] > best_split_per_leaf_[b];
+    });
+    const int max_batch_size = std::min(static_cast<int>(batch.size()),
+                                        std::min(tree_config_->leaf_batch_size, tree_config_->num_leaves - tree->num_leaves()));
+    // splits far below the best one wait, the children of this round may have better ones
+    const double min_gain = best_split_per_leaf_[batch[0]].gain * tree_config_->leaf_batch_min_gain_ratio;
+    int batch_size = 1;
+    while (batch_size < max_batch_size && best_split_per_leaf_[batch[batch_size]].gain >= min_gain) {
+      ++batch_size;
+    }
+    batch.resize(batch_size);
+    #ifdef TIMETAG
+    start_time = std::chrono::steady_clock::now();
+    #endif
+    // split the tree, then the data of all leaves at once
+    batch_split_info.resize(batch_size);
+    leaf_splits.resize(batch_size);
+    for (int j = 0; j < batch_size; ++j) {
+      const int leaf = batch[j];
+      batch_split_info[j] = best_split_per_leaf_[leaf];
+      leaf_splits[j].leaf = leaf;
+      leaf_splits[j].feature = train_data_->InnerFeatureIndex(batch_split_info[j].feature);
+      leaf_splits[j].default_left = batch_split_info[j].default_left;
+      leaf_splits[j].right_leaf = SplitTree(tree, leaf, &leaf_splits[j].threshold);
+    }
+    if (is_gradients_gathered) {
+      data_partition_->Split(leaf_splits, train_data_, gradients_, is_constant_hessian_ ? nullptr : hessians_,
+                             ordered_gradients_.data(), ordered_hessians_.data());
+    } else {
+      data_partition_->Split(leaf_splits, train_data_);
+    }
+    #ifdef TIMETAG
+    split_time += std::chrono::steady_clock::now() - start_time;
+    start_time = std::chrono::steady_clock::now();
+    #endif
+    active_children.clear();
+    active_leaves.clear();
+    for (int j = 0; j < batch_size; ++j) {
+      const int left_leaf = leaf_splits[j].leaf;
+      const int right_leaf = leaf_splits[j].right_leaf;
+      #ifdef DEBUG
+      CHECK(batch_split_info[j].left_count == data_partition_->leaf_count(left_leaf));
+      #endif
+      if (BeforeFindBestSplitsOfBatch(tree, batch_split_info[j], left_leaf, right_leaf, &batch_children_[j])) {
+        active_children.push_back(&batch_children_[j]);
+        active_leaves.emplace_back(left_leaf, right_leaf);
+      }
+      *cur_depth = std::max(*cur_depth, tree->leaf_depth(left_leaf));
+    }
+    if (has_ordered_bin_ && !active_leaves.empty()) {
+      SplitOrderedBinsOfBatch(active_leaves);
+    }
+    #ifdef TIMETAG
+    init_split_time += std::chrono::steady_clock::now() - start_time;
+    #endif
+    if (!active_children.empty()) {
+      FindBestSplitsOfBatch(active_children);
+    }
+  }
+}
+
+bool SerialTreeLearner::BeforeFindBestSplitsOfBatch(const Tree* tree, const SplitInfo& split_info,
+                                                    int left_leaf, int right_leaf, BatchChildren* children) {
+  const data_size_t num_data_in_left_child = GetGlobalDataCountInLeaf(left_leaf);
+  const data_size_t num_data_in_right_child = GetGlobalDataCountInLeaf(right_leaf);
+  // only need to check the depth of left leaf, since right leaf is in same level of left leaf
+  if ((tree_config_->max_depth > 0 && tree->leaf_depth(left_leaf) >= tree_config_->max_depth)
+      || (num_data_in_right_child < static_cast<data_size_t>(tree_config_->min_data_in_leaf * 2)
+          && num_data_in_left_child < static_cast<data_size_t>(tree_config_->min_data_in_leaf * 2))) {
+    best_split_per_leaf_[left_leaf].gain = kMinScore;
+    best_split_per_leaf_[right_leaf].gain = kMinScore;
+    return false;
+  }
+  // the pool holds the histograms of all children of the batch, see HistogramPool::CacheSize
+  if (num_data_in_left_child < num_data_in_right_child) {
+    children->smaller_leaf_splits->Init(left_leaf, data_partition_.get(),
+                                        split_info.left_sum_gradient, split_info.left_sum_hessian);
+    children->larger_leaf_splits->Init(right_leaf, data_partition_.get(),
+                                       split_info.right_sum_gradient, split_info.right_sum_hessian);
+    // put parent(left) leaf's histograms into larger leaf's histograms
+    children->use_subtract = histogram_pool_.Get(left_leaf, &children->larger_histogram_array);
+    histogram_pool_.Move(left_leaf, right_leaf);
+    histogram_pool_.Get(left_leaf, &children->smaller_histogram_array);
+  } else {
+    children->smaller_leaf_splits->Init(right_leaf, data_partition_.get(),
+                                        split_info.right_sum_gradient, split_info.right_sum_hessian);
+    children->larger_leaf_splits->Init(left_leaf, data_partition_.get(),
+                                       split_info.left_sum_gradient, split_info.left_sum_hessian);
+    // put parent(left) leaf's histograms to larger leaf's histograms
+    children->use_subtract = histogram_pool_.Get(left_leaf, &children->larger_histogram_array);
+    histogram_pool_.Get(right_leaf, &children->smaller_histogram_array);
+  }
+  return true;
+}
+
+void SerialTreeLearner::SplitOrderedBinsOfBatch(const std::vector<std::pair<int, int>>& leaves) {
+  #ifdef TIMETAG
+  auto start_time = std::chrono::steady_clock::now();
   #endif
+  // mark the data of the smaller children, the leaves don't overlap
+  const int num_splits = static_cast<int>(leaves.size());
+  const data_size_t* indices = data_partition_->indices();
+  std::vector<char> marks(num_splits, 1);
+  std::vector<int> marked_leaves(num_splits);
+  for (int j = 0; j < num_splits; ++j) {
+    marked_leaves[j] = leaves[j].first;
+    if (data_partition_->leaf_count(leaves[j].first) > data_partition_->leaf_count(leaves[j].second)) {
+      marked_leaves[j] = leaves[j].second;
+      marks[j] = 0;
+    }
+  }
+  auto mark_data = [&] (char val) {
+    #pragma omp parallel
+    for (int leaf : marked_leaves) {
+      const data_size_t begin = data_partition_->leaf_begin(leaf);
+      const data_size_t end = begin + data_partition_->leaf_count(leaf);
+      #pragma omp for schedule(static, 512) nowait
+      for (data_size_t i = begin; i < end; ++i) {
+        is_data_in_leaf_[indices[i]] = val;
+      }
+    }
+  };
+  mark_data(1);
+  OMP_INIT_EX();
+  // split the ordered bin
+  #pragma omp parallel for schedule(static)
+  for (int i = 0; i < static_cast<int>(ordered_bin_indices_.size()); ++i) {
+    OMP_LOOP_EX_BEGIN();
+    for (int j = 0; j < num_splits; ++j) {
+      ordered_bins_[ordered_bin_indices_[i]]->Split(leaves[j].first, leaves[j].second, is_data_in_leaf_.data(), marks[j]);
+    }
+    OMP_LOOP_EX_END();
+  }
+  OMP_THROW_EX();
+  mark_data(0);
+  #ifdef TIMETAG
+  ordered_bin_time += std::chrono::steady_clock::now() - start_time;
+  #endif
+}
 
-  // init the leaves that used on next iteration
-  if (best_split_info.left_count < best_split_info.right_count) {
-    smaller_leaf_splits_->Init(*left_leaf, data_partition_.get(),
-                               best_split_info.left_sum_gradient,
-                               best_split_info.left_sum_hessian);
-    larger_leaf_splits_->Init(*right_leaf, data_partition_.get(),
-                              best_split_info.right_sum_gradient,
-                              best_split_info.right_sum_hessian);
+void SerialTreeLearner::FindBestSplitsOfBatch(const std::vector<BatchChildren*>& batch_children) {
+  #ifdef TIMETAG
+  auto start_time = std::chrono::steady_clock::now();
+  #endif
+  // the smaller children, and the larger ones whose parent is not in the pool
+  std::vector<Dataset::LeafHistogram> leaves;
+  for (const BatchChildren* children : batch_children) {
+    const LeafSplits* leaf_splits = children->smaller_leaf_splits.get();
+    for (int k = 0; k < 2; ++k) {
+      const data_size_t begin = data_partition_->leaf_begin(leaf_splits->LeafIndex());
+      FeatureHistogram* histogram_array = k == 0 ? children->smaller_histogram_array : children->larger_histogram_array;
+      // gradients of the smaller children were gathered while partitioning, at the positions of their indices
+      leaves.push_back({leaf_splits->LeafIndex(), leaf_splits->data_indices(), leaf_splits->num_data_in_leaf(),
+                        ordered_gradients_.data() + begin, ordered_hessians_.data() + begin, k == 0,
+                        histogram_array[0].RawData() - 1});
+      if (children->use_subtract) { break; }
+      leaf_splits = children->larger_leaf_splits.get();
+    }
+  }
+  if (is_row_wise_ || gradient_quant_bits_ > 0) {
+    // these use all threads for one leaf
+    for (const auto& leaf : leaves) {
+      if (is_row_wise_) {
+        train_data_->ConstructRowWiseHistograms(row_ptr_, row_bins_, leaf.data_indices, leaf.num_data,
+                                                gradients_, hessians_, is_constant_hessian_, num_threads_,
+                                                &row_wise_hist_buffer_, leaf.histogram_data);
+      } else {
+        train_data_->ConstructQuantizedHistograms(is_feature_used_, leaf.data_indices, leaf.num_data, leaf.leaf_idx,
+                                                  ordered_bins_, packed_gradients_.data(), ordered_packed_gradients_.data(),
+                                                  gradient_scale_, hessian_scale_, quantized_histogram_.data(),
+                                                  leaf.histogram_data);
+      }
+    }
   } else {
-    smaller_leaf_splits_->Init(*right_leaf, data_partition_.get(), best_split_info.right_sum_gradient, best_split_info.right_sum_hessian);
-    larger_leaf_splits_->Init(*left_leaf, data_partition_.get(), best_split_info.left_sum_gradient, best_split_info.left_sum_hessian);
+    train_data_->ConstructHistograms(is_feature_used_, leaves, ordered_bins_, gradients_, hessians_,
+                                     is_constant_hessian_);
   }
+  #ifdef TIMETAG
+  hist_time += std::chrono::steady_clock::now() - start_time;
+  start_time = std::chrono::steady_clock::now();
+  #endif
+  // best splits of the smaller and larger child of each split by thread
+  const int num_splits = static_cast<int>(batch_children.size());
+  std::vector<SplitInfo> best_splits(static_cast<size_t>(num_threads_) * num_splits * 2);
+  OMP_INIT_EX();
+  // expensive features of all splits first, dynamically scheduled to balance the threads
+  const int num_used_features = static_cast<int>(used_feature_indices_.size());
+  #pragma omp parallel for schedule(dynamic)
+  for (int task = 0; task < num_used_features * num_splits; ++task) {
+    OMP_LOOP_EX_BEGIN();
+    const int feature_index = used_feature_indices_[task / num_splits];
+    const int j = task % num_splits;
+    if (!is_feature_used_[feature_index]) { continue; }
+    BatchChildren* children = batch_children[j];
+    // not splittable in the parent
+    if (children->use_subtract && !children->larger_histogram_array[feature_index].is_splittable()) {
+      children->smaller_histogram_array[feature_index].set_is_splittable(false);
+      continue;
+    }
+    SplitInfo* best = best_splits.data() + (static_cast<size_t>(omp_get_thread_num()) * num_splits + j) * 2;
+    const LeafSplits* smaller_leaf_splits = children->smaller_leaf_splits.get();
+    const LeafSplits* larger_leaf_splits = children->larger_leaf_splits.get();
+    const int real_fidx = train_data_->RealFeatureIndex(feature_index);
+    SplitInfo smaller_split;
+    train_data_->FixHistogram(feature_index,
+                              smaller_leaf_splits->sum_gradients(), smaller_leaf_splits->sum_hessians(),
+                              smaller_leaf_splits->num_data_in_leaf(),
+                              children->smaller_histogram_array[feature_index].RawData());
+    children->smaller_histogram_array[feature_index].FindBestThreshold(
+      smaller_leaf_splits->sum_gradients(),
+      smaller_leaf_splits->sum_hessians(),
+      smaller_leaf_splits->num_data_in_leaf(),
+      &smaller_split);
+    smaller_split.feature = real_fidx;
+    if (smaller_split > best[0]) {
+      best[0] = smaller_split;
+    }
+    if (children->use_subtract) {
+      children->larger_histogram_array[feature_index].Subtract(children->smaller_histogram_array[feature_index]);
+    } else {
+      train_data_->FixHistogram(feature_index, larger_leaf_splits->sum_gradients(), larger_leaf_splits->sum_hessians(),
+                                larger_leaf_splits->num_data_in_leaf(),
+                                children->larger_histogram_array[feature_index].RawData());
+    }
+    SplitInfo larger_split;
+    children->larger_histogram_array[feature_index].FindBestThreshold(
+      larger_leaf_splits->sum_gradients(),
+      larger_leaf_splits->sum_hessians(),
+      larger_leaf_splits->num_data_in_leaf(),
+      &larger_split);
+    larger_split.feature = real_fidx;
+    if (larger_split > best[1]) {
+      best[1] = larger_split;
+    }
+    OMP_LOOP_EX_END();
+  }
+  OMP_THROW_EX();
+  for (int j = 0; j < num_splits; ++j) {
+    const int leaves_of_split[2] = {batch_children[j]->smaller_leaf_splits->LeafIndex(),
+                                    batch_children[j]->larger_leaf_splits->LeafIndex()};
+    for (int k = 0; k < 2; ++k) {
+      // first maximum of the threads, like ArgMax
+      const SplitInfo* best = &best_splits[j * 2 + k];
+      for (int tid = 1; tid < num_threads_; ++tid) {
+        const SplitInfo& split = best_splits[(static_cast<size_t>(tid) * num_splits + j) * 2 + k];
+        if (split > *best) {
+          best = &split;
+        }
+      }
+      best_split_per_leaf_[leaves_of_split[k]] = *best;
+    }
+  }
+  #ifdef TIMETAG
+  find_split_time += std::chrono::steady_clock::now() - start_time;
+  #endif
 }
 
 }  // namespace LightGBM
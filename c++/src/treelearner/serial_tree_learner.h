@@ -18,6 +18,7 @@
 #include <random>
 #include <cmath>
 #include <memory>
+#include <utility>
 #ifdef USE_GPU
 // Use 4KBytes aligned allocator for ordered gradients and ordered hessians when GPU is enabled.
 // This is necessary to pin the two arrays in memory and make transferring faster.
@@ -49,6 +50,14 @@ public:
     data_partition_->SetUsedDataIndices(used_indices, num_data);
   }
 
+  unsigned int GetRandomState() const override { return random_.state(); }
+
+  void SetRandomState(unsigned int state) override { random_.set_state(state); }
+
+  unsigned int GetQuantRandomState() const override { return quant_random_.state(); }
+
+  void SetQuantRandomState(unsigned int state) override { quant_random_.set_state(state); }
+
   void AddPredictionToScore(const Tree* tree, double* out_score) const override {
     if (tree->num_leaves() <= 1) { return; }
     CHECK(tree->num_leaves() <= data_partition_->num_leaves());
@@ -80,6 +89,22 @@ protected:
 
   virtual void FindBestSplitsFromHistograms(const std::vector<int8_t>& is_feature_used, bool use_subtract);
 
+  /*!
+  * \brief Create the ordered bins, or the bins by row for row-wise histograms
+  */
+  void ResetRowWiseBins();
+
+  /*!
+  * \brief Choose the quantization bits for the current data and config, and allocate the buffers
+  */
+  void ResetGradientQuantization();
+
+  /*!
+  * \brief Quantize the gradients and hessians of current iteration with stochastic rounding,
+  *        and pack them to packed_gradients_
+  */
+  void QuantizeGradients();
+
   /*!
   * \brief Partition tree and data according best split.
   * \param tree Current tree, will be splitted on this function.
@@ -89,6 +114,49 @@ protected:
   */
   virtual void Split(Tree* tree, int best_leaf, int* left_leaf, int* right_leaf);
 
+  /*!
+  * \brief Split the tree according best split of the leaf, without partitioning the data
+  * \param threshold Output thresholds of the data partition, bitset of categorical bins or one numerical bin
+  * \return The index of right leaf
+  */
+  int SplitTree(Tree* tree, int best_leaf, std::vector<uint32_t>* threshold);
+
+  /*! \brief Init the smaller and larger leaf splits for the leaves after a split */
+  void InitLeafSplits(const SplitInfo& split_info, int left_leaf, int right_leaf);
+
+  /*!
+  * \brief Grow the tree by splitting up to leaf_batch_size leaves with the largest gains per round,
+  *        with one data partition pass, one histogram construction and one split search for all of them
+  * \param cur_depth Max depth of the tree
+  */
+  void GrowByBatches(Tree* tree, int* cur_depth);
+
+  /*! \brief Children of a leaf split in a batch */
+  struct BatchChildren {
+    std::unique_ptr<LeafSplits> smaller_leaf_splits;
+    std::unique_ptr<LeafSplits> larger_leaf_splits;
+    FeatureHistogram* smaller_histogram_array;
+    FeatureHistogram* larger_histogram_array;
+    /*! \brief True if larger_histogram_array holds the histograms of the parent, to subtract the smaller ones from */
+    bool use_subtract;
+  };
+
+  /*!
+  * \brief Get the histograms of the children of a split in a batch from the pool, like BeforeFindBestSplit
+  * \return False if the children cannot be split further
+  */
+  bool BeforeFindBestSplitsOfBatch(const Tree* tree, const SplitInfo& split_info, int left_leaf, int right_leaf,
+                                   BatchChildren* children);
+
+  /*!
+  * \brief Split the ordered bins for the children of all splits in a batch, with one pass over the bins
+  * \param leaves (left leaf, right leaf) of the splits
+  */
+  void SplitOrderedBinsOfBatch(const std::vector<std::pair<int, int>>& leaves);
+
+  /*! \brief Construct the histograms of the children in one pass, then search their best splits in one parallel loop */
+  void FindBestSplitsOfBatch(const std::vector<BatchChildren*>& batch_children);
+
   /*!
   * \brief Get the number of data in a leaf
   * \param leaf_idx The index of leaf
@@ -111,6 +179,16 @@ protected:
   Random random_;
   /*! \brief used for sub feature training, is_feature_used_[i] = false means don't used feature i */
   std::vector<int8_t> is_feature_used_;
+  /*! \brief Features by number of bins, most first, the order to search splits in */
+  std::vector<int> split_feature_order_;
+  /*! \brief Position of each feature in split_feature_order_ */
+  std::vector<int> split_feature_rank_;
+  /*! \brief Features sampled for the current tree in split_feature_order_, the set entries of is_feature_used_ */
+  std::vector<int> used_feature_indices_;
+  /*! \brief Used features of the current leaf, excluding the ones that cannot be split in its parent */
+  std::vector<int8_t> is_feature_used_in_leaf_;
+  /*! \brief The set entries of is_feature_used_in_leaf_ */
+  std::vector<int> leaf_feature_indices_;
   /*! \brief pointer to histograms array of parent of current leaves */
   FeatureHistogram* parent_leaf_histogram_array_;
   /*! \brief pointer to histograms array of smaller leaf */
@@ -125,6 +203,8 @@ protected:
   std::unique_ptr<LeafSplits> smaller_leaf_splits_;
   /*! \brief stores best thresholds for all feature for larger leaf */
   std::unique_ptr<LeafSplits> larger_leaf_splits_;
+  /*! \brief Children of the splits of the current batch, see GrowByBatches */
+  std::vector<BatchChildren> batch_children_;
 
 #ifdef USE_GPU
   /*! \brief gradients of current iteration, ordered for cache optimized, aligned to 4K page */
@@ -140,6 +220,8 @@ protected:
 
   /*! \brief Store ordered bin */
   std::vector<std::unique_ptr<OrderedBin>> ordered_bins_;
+  /*! \brief Leaf whose gradients are in ordered_gradients_, gathered when its data was partitioned, -1 for none */
+  int ordered_gradients_leaf_ = -1;
   /*! \brief True if has ordered bin */
   bool has_ordered_bin_ = false;
   /*! \brief  is_data_in_leaf_[i] != 0 means i-th data is marked */
@@ -151,6 +233,30 @@ protected:
   int num_threads_;
   std::vector<int> ordered_bin_indices_;
   bool is_constant_hessian_;
+  /*! \brief Bits of quantized gradients, 0 means not quantized */
+  int gradient_quant_bits_ = 0;
+  /*! \brief Used for the stochastic rounding of gradients */
+  Random quant_random_;
+  /*! \brief Gradient of one quantization step in current iteration */
+  double gradient_scale_ = 1.0f;
+  /*! \brief Hessian of one quantization step in current iteration */
+  double hessian_scale_ = 1.0f;
+  /*! \brief Packed quantized gradients and hessians of current iteration */
+  std::vector<packed_grad_t> packed_gradients_;
+  /*! \brief Packed quantized gradients and hessians, ordered for cache optimized */
+  std::vector<packed_grad_t> ordered_packed_gradients_;
+  /*! \brief Buffer of the integer histograms before they are rescaled */
+  std::vector<QuantizedHistogramBinEntry> quantized_histogram_;
+  /*! \brief Row-wise histograms are used when non-zero groups per row * kRowWiseGroupRatio < number of groups */
+  static constexpr double kRowWiseGroupRatio = 4.0f;
+  /*! \brief True if histograms are constructed by rows instead of by feature groups */
+  bool is_row_wise_ = false;
+  /*! \brief Bins of row i are row_bins_[row_ptr_[i], row_ptr_[i + 1]) */
+  std::vector<uint64_t> row_ptr_;
+  /*! \brief Non-zero global bin ids of all rows */
+  std::vector<uint32_t> row_bins_;
+  /*! \brief Private histograms of the row blocks */
+  std::vector<HistogramBinEntry> row_wise_hist_buffer_;
 };
 
 inline data_size_t SerialTreeLearner::GetGlobalDataCountInLeaf(int leafIdx) const {